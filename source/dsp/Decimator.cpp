@@ -0,0 +1,211 @@
+#include "Decimator.h"
+#include <juce_dsp/juce_dsp.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include "hiir/PolyphaseIir2Designer.h"
+
+Decimator::Decimator()
+{
+    double wide[3], narrow[8];
+    hiir::PolyphaseIir2Designer::compute_coefs_spec_order_tbw(wide, 3, .28);
+    hiir::PolyphaseIir2Designer::compute_coefs_spec_order_tbw(narrow, 8, .03);
+
+    stage0.setCoefs(wide, 3);   // 8x -> 4x, wide tb
+    stage1.setCoefs(wide, 3);   // 2x down with wide tb
+    stage2.setCoefs(narrow, 8); // 2x down with narrow tb
+}
+
+void Decimator::prepare(const double sampleRate)
+{
+    for (size_t i = 0; i < firs.size(); i++)
+        firs[i].design(sampleRate, 2 << i);
+
+    // the slowest factor sets the mode's latency; a fractional IIR delay is rounded up so every pad is positive
+    int longest = 0;
+    for (const auto m : {Mode::iir, Mode::fir})
+    {
+        double worst = 0.0;
+        for (const int f : {2, 4, 8})
+            worst = std::max(worst, rawDelay(f, m));
+        modeLatency[size_t(m)] = static_cast<int>(std::ceil(worst - 0.001));
+        longest = std::max(longest, modeLatency[size_t(m)]);
+    }
+    for (auto &l : padLine)
+        l.assign(size_t(std::max(1, longest)), 0.0f);
+
+    setup(factor, mode);
+}
+
+// the filters' own delay at DC, in host samples
+double Decimator::rawDelay(const int forFactor, const Mode forMode) const
+{
+    if (forFactor <= 1)
+        return 0.0;
+    if (forMode == Mode::fir)
+        return firs[size_t(std::countr_zero(unsigned(forFactor)) - 1)].latency;
+
+    double delay = stage2.getDelay();
+    if (forFactor >= 4)
+        delay += stage1.getDelay() / 2.0;
+    if (forFactor == 8)
+        delay += stage0.getDelay() / 4.0;
+    return delay;
+}
+
+void Decimator::setup(const int newFactor, const Mode newMode)
+{
+    factor = newFactor;
+    mode = newMode;
+    pad = std::max(0, juce::roundToInt(modeLatency[size_t(mode)] - rawDelay(factor, mode)));
+    jassert(pad <= int(padLine[0].size()));
+    clear();
+}
+
+void Decimator::clear()
+{
+    stage0.clear();
+    stage1.clear();
+    stage2.clear();
+    for (auto &fir : firs)
+        fir.clear();
+    for (auto &l : padLine)
+        std::fill(l.begin(), l.end(), 0.0f);
+    padPos = 0;
+}
+
+void Decimator::process(float *outL, float *outR, const float *inL, const float *inR, const int numOut)
+{
+    if (factor <= 1)
+    {
+        if (outL != inL)
+        {
+            std::copy_n(inL, numOut, outL);
+            std::copy_n(inR, numOut, outR);
+        }
+    }
+    else if (mode == Mode::fir)
+    {
+        firs[size_t(std::countr_zero(unsigned(factor)) - 1)].process(outL, outR, inL, inR, numOut);
+    }
+    else
+    {
+        processIir(outL, outR, inL, inR, numOut);
+    }
+    processPad(outL, outR, numOut);
+}
+
+// delays the output by 'pad' samples, to make up the mode's latency
+void Decimator::processPad(float *outL, float *outR, const int numOut)
+{
+    if (pad == 0)
+        return;
+
+    float *const outs[2]{outL, outR};
+    int pos = padPos;
+    for (size_t ch = 0; ch < 2; ch++)
+    {
+        auto *line = padLine[ch].data();
+        pos = padPos;
+        for (int i = 0; i < numOut; i++)
+        {
+            const float x = outs[ch][i];
+            outs[ch][i] = line[pos];
+            line[pos] = x;
+            if (++pos == pad)
+                pos = 0;
+        }
+    }
+    padPos = pos;
+}
+
+void Decimator::processIir(float *outL, float *outR, const float *inL, const float *inR, const int numOut)
+{
+    if (factor == 2)
+    {
+        stage2.process(outL, outR, inL, inR, numOut);
+        return;
+    }
+
+    for (int done = 0; done < numOut; done += chunk)
+    {
+        const int n = std::min(chunk, numOut - done);
+        const float *l = inL + done * factor;
+        const float *r = inR + done * factor;
+        if (factor == 8)
+        {
+            stage0.process(scratch4[0].data(), scratch4[1].data(), l, r, n * 4);
+            l = scratch4[0].data();
+            r = scratch4[1].data();
+        }
+        stage1.process(scratch2[0].data(), scratch2[1].data(), l, r, n * 2);
+        stage2.process(outL + done, outR + done, scratch2[0].data(), scratch2[1].data(), n);
+    }
+}
+
+//==============================================================================
+void Decimator::Fir::design(const double sampleRate, const int newRatio)
+{
+    ratio = newRatio;
+    const double highRate = sampleRate * ratio;
+
+    // anything between the edges folds back above passEdge, so it can pass
+    const double passEdge = std::min(20000.0, 0.45 * sampleRate);
+    const double stopEdge = sampleRate - passEdge;
+    const auto coefs = juce::dsp::FilterDesign<float>::designFIRLowpassKaiserMethod(
+        static_cast<float>(0.5 * sampleRate), highRate, static_cast<float>((stopEdge - passEdge) / highRate), -100.0f);
+    const auto &h = coefs->coefficients;
+
+    // zeros in front of the filter make its delay a whole number of host samples
+    const int centre = (h.size() - 1) / 2;
+    const int pad = ((ratio - 1 - centre) % ratio + ratio) % ratio;
+    latency = (centre + pad - ratio + 1) / ratio;
+
+    float sum = 0.0f;
+    for (const auto v : h)
+        sum += v;
+
+    taps.assign(size_t(h.size() + pad), 0.0f);
+    for (int k = 0; k < h.size(); k++)
+        taps[size_t(h.size() - 1 - k)] = h[k] / sum;
+
+    for (auto &l : line)
+        l.assign(taps.size() - 1 + size_t(ratio * chunk), 0.0f);
+}
+
+void Decimator::Fir::clear()
+{
+    for (auto &l : line)
+        std::fill(l.begin(), l.end(), 0.0f);
+}
+
+void Decimator::Fir::process(float *outL, float *outR, const float *inL, const float *inR, const int numOut)
+{
+    const size_t numTaps = taps.size();
+    const size_t history = numTaps - 1;
+    float *const outs[2]{outL, outR};
+    const float *const ins[2]{inL, inR};
+
+    for (int done = 0; done < numOut; done += chunk)
+    {
+        const int n = std::min(chunk, numOut - done);
+        const auto consumed = size_t(n * ratio);
+        for (size_t ch = 0; ch < 2; ch++)
+        {
+            auto &l = line[ch];
+            std::copy_n(ins[ch] + done * ratio, consumed, l.begin() + long(history));
+
+            // out[i] = sum over k of h[k] * in[ratio * i + ratio - 1 - k]
+            for (int i = 0; i < n; i++)
+            {
+                const float *x = l.data() + i * ratio + ratio - 1;
+                float acc = 0.0f;
+                for (size_t j = 0; j < numTaps; j++)
+                    acc += taps[j] * x[j];
+                outs[ch][done + i] = acc;
+            }
+
+            std::copy_n(l.begin() + long(consumed), history, l.begin());
+        }
+    }
+}
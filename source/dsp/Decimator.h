@@ -0,0 +1,91 @@
+/*
+ * PM Daze - an expressive, semi-modular, phase-modulation synthesizer
+ *
+ * Copyright 2025, Greg Recco
+ *
+ * PM Daze is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source code for PM Daze is available at
+ * https://github.com/gregrecco67/PMDaze
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include "PolyphaseStereo.h"
+
+//==============================================================================
+// Brings the synth's oversampled output down to the host rate, 2:1, 4:1 or
+// 8:1, in one call.
+//
+// The IIR flavour cascades hiir's polyphase half-band stages. They run a chunk
+// at a time through small scratch arrays, so nothing between the stages goes
+// back out to a full-size buffer. Its delay is a sample or two.
+//
+// The FIR flavour is one linear-phase Kaiser lowpass for the whole ratio, run
+// polyphase so only the samples that are kept get computed. It passes up to
+// 20 kHz flat and in phase. Its delay is half its length: 19 samples at
+// 48 kHz, 32 at 44.1 kHz, where the transition band is narrower.
+//
+// Each mode reports one latency whatever the factor, that of its slowest
+// factor, and pads the faster ones (1:1 included) with a plain delay, so Auto
+// can switch factors without the host having to re-align the track.
+class Decimator
+{
+  public:
+    enum class Mode
+    {
+        iir,
+        fir
+    };
+
+    Decimator();
+
+    // message thread: designs the FIR filters for this host rate
+    void prepare(double sampleRate);
+
+    // audio thread, between blocks
+    void setup(int newFactor, Mode newMode);
+    void clear();
+
+    // 'in' holds numOut * factor samples per channel; at 1:1 it may be 'out' itself
+    void process(float *outL, float *outR, const float *inL, const float *inR, int numOut);
+
+    // at the host rate, the same for every factor of the current mode
+    [[nodiscard]] int getLatencySamples() const { return modeLatency[size_t(mode)]; }
+
+  private:
+    static constexpr int chunk = 64; // host-rate samples per pass through the scratch arrays
+
+    struct Fir
+    {
+        int ratio{2};
+        std::vector<float> taps;                // time-reversed, so each output is a dot product
+        std::array<std::vector<float>, 2> line; // the last taps.size() - 1 inputs, then a chunk's worth
+        int latency{0};
+
+        void design(double sampleRate, int newRatio);
+        void clear();
+        void process(float *outL, float *outR, const float *inL, const float *inR, int numOut);
+    };
+
+    void processIir(float *outL, float *outR, const float *inL, const float *inR, int numOut);
+    void processPad(float *outL, float *outR, int numOut);
+    [[nodiscard]] double rawDelay(int forFactor, Mode forMode) const;
+
+    StereoDownsampler2x stage0, stage1, stage2; // 8x -> 4x, 4x -> 2x, 2x -> 1x
+    std::array<Fir, 3> firs;                    // 2:1, 4:1, 8:1
+    std::array<std::array<float, chunk * 4>, 2> scratch4{};
+    std::array<std::array<float, chunk * 2>, 2> scratch2{};
+
+    std::array<int, 2> modeLatency{}; // by mode
+    std::array<std::vector<float>, 2> padLine; // long enough for either mode's longest pad
+    int pad{0}, padPos{0};
+
+    int factor{1};
+    Mode mode{Mode::iir};
+};
@@ -253,6 +253,155 @@ float Envelope::getNextSample() noexcept
     return out; // envelopeVal;
 }
 
+void Envelope::processBlock(float *out, const int numSamples) noexcept
+{
+    int done = 0;
+    while (done < numSamples)
+    {
+        const int run = std::min(numSamples - done, samplesToBoundary());
+        if (run > 0)
+        {
+            renderRun(out + done, run);
+            done += run;
+        }
+        else
+        {
+            // segment boundaries go through the regular per-sample path
+            getNextSample();
+            out[done++] = getOutput();
+        }
+    }
+}
+
+int Envelope::samplesToBoundary() const noexcept
+{
+    // conservative: one sample short of where the state could change, so the
+    // transition itself always happens in getNextSample()
+    constexpr double margin = 1.0;
+    constexpr double unbounded = 1.0e9;
+
+    const auto steps = [](double distance, double rate) { return rate > 0.0 ? distance / rate - margin : unbounded; };
+    const double timer = (duration - timeSinceStart) / inverseSampleRate - margin;
+
+    double n = 0.0;
+    switch (state)
+    {
+    case State::idle:
+    case State::sustain:
+        n = unbounded;
+        break;
+    case State::attack:
+        n = steps(.999 - linearIdxVal, attackRate);
+        break;
+    case State::ADRattack:
+        n = std::min(steps(.999 - linearIdxVal, attackRate), timer);
+        break;
+    case State::decay:
+        n = parameters.sustainLevel < 1.0 ? steps(linearIdxVal, decayRate) : 0.0;
+        break;
+    case State::ADRdecay:
+        n = parameters.sustainLevel < 1.0 ? std::min(steps(linearIdxVal, decayRate), timer) : 0.0;
+        break;
+    case State::release:
+        n = juce::approximatelyEqual(linearIdxVal, 1.0) ? 0.0 : steps(linearIdxVal - .001, releaseRate);
+        break;
+    case State::ADRrelease:
+        n = juce::approximatelyEqual(linearIdxVal, 1.0) ? 0.0 : std::min(steps(linearIdxVal - .001, releaseRate), timer);
+        break;
+    case State::ADRSyncIdle:
+        n = timer;
+        break;
+    }
+    return static_cast<int>(std::clamp(n, 0.0, unbounded));
+}
+
+void Envelope::renderRun(float *out, const int numSamples) noexcept
+{
+    const auto idx0 = static_cast<float>(linearIdxVal);
+
+    switch (state)
+    {
+    case State::idle:
+    case State::ADRSyncIdle:
+    {
+        finalOut = 0.0;
+        std::fill(out, out + numSamples, 0.0f);
+    }
+    break;
+
+    case State::sustain:
+    {
+        linearIdxVal = 1.0;
+        finalOut = parameters.sustainLevel;
+        releaseStart = finalOut;
+        std::fill(out, out + numSamples, static_cast<float>(finalOut));
+    }
+    break;
+
+    case State::attack:
+    case State::ADRattack:
+    {
+        const auto rate = static_cast<float>(attackRate);
+        for (int i = 0; i < numSamples; i++)
+            out[i] = valForIdxF(std::min(idx0 + float(i + 1) * rate, 1.0f), true);
+
+        linearIdxVal = std::clamp(linearIdxVal + numSamples * attackRate, 0.0, 1.0);
+        finalOut = releaseStart = out[numSamples - 1];
+    }
+    break;
+
+    case State::decay:
+    case State::ADRdecay:
+    {
+        const auto rate = static_cast<float>(decayRate);
+        const auto sustain = static_cast<float>(parameters.sustainLevel);
+        for (int i = 0; i < numSamples; i++)
+            out[i] = sustain + valForIdxF(std::max(idx0 - float(i + 1) * rate, 0.0f), false) * (1.0f - sustain);
+
+        linearIdxVal = std::clamp(linearIdxVal - numSamples * decayRate, 0.0, 1.0);
+        finalOut = releaseStart = out[numSamples - 1];
+    }
+    break;
+
+    case State::release:
+    case State::ADRrelease:
+    {
+        const auto rate = static_cast<float>(releaseRate);
+        const auto start = static_cast<float>(releaseStart);
+        for (int i = 0; i < numSamples; i++)
+            out[i] = start * valForIdxF(std::max(idx0 - float(i + 1) * rate, 0.0f), false);
+
+        linearIdxVal = std::clamp(linearIdxVal - numSamples * releaseRate, 0.0, 1.0);
+        finalOut = out[numSamples - 1];
+    }
+    break;
+    }
+
+    timeSinceStart += static_cast<float>(numSamples * inverseSampleRate);
+}
+
+float Envelope::lookupF(const float xPos, const float fracPos) const noexcept
+{
+    const int x = std::clamp(static_cast<int>(xPos), 0, 1023);
+    const float frac = fracPos - std::floor(fracPos);
+    return (1 - frac) * convexF[size_t(x)] + frac * convexF[size_t(std::min(x + 1, 1023))];
+}
+
+// float version of getValForIdx(), same curves
+float Envelope::valForIdxF(const float idx, const bool isAttack) const noexcept
+{
+    const auto c = static_cast<float>(isAttack ? parameters.aCurve : parameters.dRCurve);
+    if (isAttack)
+    {
+        if (c > 0)
+            return (1 - c) * idx + c * (1 - lookupF((1 - idx) * 1024.f, (1 - idx) * 1024.f));
+        return (1 + c) * idx - c * lookupF(idx * 1024.f, idx * 1024.f);
+    }
+    if (c < 0)
+        return (1 + c) * idx - c * lookupF(idx * 1024.f, idx * 1024.f);
+    return (1 - c) * idx + c * (1 - lookupF((1 - idx) * 1024.f, idx * 1024.f));
+}
+
 //==============================================================================
 
 void Envelope::recalculateRates() noexcept
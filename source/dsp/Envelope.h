@@ -20,7 +20,7 @@ class Envelope
 {
   public:
     //==============================================================================
-    explicit Envelope(const std::array<double, 1024> &convex_) : convex(convex_)
+    Envelope(const std::array<double, 1024> &convex_, const std::array<float, 1024> &convexF_) : convex(convex_), convexF(convexF_)
     {
         recalculateRates();
     }
@@ -28,6 +28,7 @@ class Envelope
     ~Envelope() = default;
 
     const std::array<double, 1024> &convex;
+    const std::array<float, 1024> &convexF; // same curve, for block rendering
 
     //==============================================================================
     enum class State
@@ -81,6 +82,7 @@ class Envelope
     }
 
     [[nodiscard]] inline bool isActive() const noexcept { return state != State::idle; }
+    [[nodiscard]] inline bool isReleasing() const noexcept { return state == State::release; }
     [[nodiscard]] inline float getValue() const { return static_cast<float>(finalOut); }
     [[nodiscard]] inline float getOutput() const { return static_cast<float>(finalOut); }
 
@@ -102,6 +104,9 @@ class Envelope
     [[nodiscard]] double getIdxForVal(const double val) const;
 
     float getNextSample() noexcept;
+
+    // renders getOutput() for the next numSamples samples, a segment at a time
+    void processBlock(float *out, int numSamples) noexcept;
     void advance(const int frames)
     {
         for (int i = 0; i < frames; i++)
@@ -115,6 +120,11 @@ class Envelope
     void recalculateRates() noexcept;
     void goToNextState() noexcept;
 
+    [[nodiscard]] int samplesToBoundary() const noexcept;
+    void renderRun(float *out, int numSamples) noexcept;
+    [[nodiscard]] inline float lookupF(float xPos, float fracPos) const noexcept;
+    [[nodiscard]] inline float valForIdxF(float idx, bool isAttack) const noexcept;
+
     //==============================================================================
 
     State state = State::idle;
@@ -22,6 +22,7 @@
 #include <cmath>
 #include <memory>
 #include <numbers>
+#include <vector>
 #include "FastMath.hpp"
 #include "LFO.h"
 #include "ADAAsrc/TanhNL.h"
@@ -32,20 +33,9 @@
 #include "ADAAsrc/Fullwave.h"
 #include "ADAAsrc/Folder.h"
 
-#define MINI_BLOCK_SIZE 32
 #define C5_95 (-0.017005f)
 #define C5_m95 0.017005f
 
-#if USE_NEON
-#include "hiir/Downsampler2xNeon.h"
-#include "hiir/Upsampler2xNeon.h"
-#endif
-
-#if USE_SSE
-#include "hiir/Upsampler2xSse.h"
-#include "hiir/Downsampler2xSse.h"
-#endif
-
 using std::numbers::inv_pi_v;
 
 class ChorusProcessor
@@ -905,11 +895,9 @@ class WaveShaperProcessor
         auto upsampledSpec = spec;
         upsampledRate = sampleRate * 2.0;
         upsampledSpec.sampleRate = upsampledRate;
-
-        usL.set_coefs(coefs1);
-        usR.set_coefs(coefs1);
-        dsL.set_coefs(coefs1);
-        dsR.set_coefs(coefs1);
+        upsampledSpec.maximumBlockSize *= 2;
+        dryL.assign(upsampledSpec.maximumBlockSize, 0.0f);
+        dryR.assign(upsampledSpec.maximumBlockSize, 0.0f);
 
         drive.reset(upsampledRate, 0.10f);
         preGain.prepare(upsampledSpec);
@@ -921,10 +909,10 @@ class WaveShaperProcessor
         *hsUp.state = *juce::dsp::IIR::Coefficients<float>::makeHighShelf(upsampledRate, 6500.f, 1.0f, 25.f);
         hsDown.prepare(upsampledSpec);
         *hsDown.state = *juce::dsp::IIR::Coefficients<float>::makeHighShelf(upsampledRate, 6500.f, 1.0f, 0.04f);
-        highPassPost.prepare(spec);
-        *highPassPost.state = *juce::dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, 40.0f);
+        highPassPost.prepare(upsampledSpec);
+        *highPassPost.state = *juce::dsp::IIR::Coefficients<float>::makeHighPass(upsampledRate, 40.0f);
         postGain.setRampDurationSeconds(0.05);
-        postGain.prepare(spec);
+        postGain.prepare(upsampledSpec);
         tanhprocs[0].get()->prepare(upsampledRate, spec.maximumBlockSize);
         tanhprocs[1].get()->prepare(upsampledRate, spec.maximumBlockSize);
         halfwaveprocs[0].get()->prepare(upsampledRate, spec.maximumBlockSize);
@@ -937,44 +925,36 @@ class WaveShaperProcessor
         fullwaveprocs[1].get()->prepare(upsampledRate, spec.maximumBlockSize);
     }
 
+    // 'context' is at twice the host rate: the lane runs this inside an OversampledSection
     void process(const juce::dsp::ProcessContextReplacing<float> &context)
     {
-        const int numSamples = static_cast<int>(context.getOutputBlock().getNumSamples());
-        const auto numSamples2 = numSamples * 2;
+        const int numSamples2 = static_cast<int>(context.getOutputBlock().getNumSamples());
 
         auto *dataL = context.getOutputBlock().getChannelPointer(0);
         auto *dataR = context.getOutputBlock().getChannelPointer(1);
-        usL.process_block(us1L, dataL, numSamples);
-        usR.process_block(us1R, dataR, numSamples);
-        float *channels[2]{us1L, us1R};
-        auto upblock = juce::dsp::AudioBlock<float>(channels, static_cast<size_t>(2), static_cast<size_t>(numSamples2));
-        const auto upcontext = juce::dsp::ProcessContextReplacing<float>(upblock);
 
-        for (int i = 0; i < MINI_BLOCK_SIZE * 2; ++i)
+        for (int i = 0; i < numSamples2; ++i)
         {
-            us2L[i] = us1L[i]; // copy for dry signal
-            us2R[i] = us1R[i];
+            dryL[size_t(i)] = dataL[i]; // copy for dry signal
+            dryR[size_t(i)] = dataR[i];
         }
 
         drive.skip(numSamples2);
         preGain.setGainDecibels(drive.getCurrentValue());
-        preGain.process(upcontext);
-        hsUp.process(upcontext);
-        applyWSFunction(upcontext);
-        hsDown.process(upcontext);
+        preGain.process(context);
+        hsUp.process(context);
+        applyWSFunction(context);
+        hsDown.process(context);
         lpfCutoff.skip(numSamples2);
         lpf.setCutoffFrequency(lpfCutoff.getCurrentValue());
-        lpf.process(upcontext);
+        lpf.process(context);
 
         for (int i = 0; i < numSamples2; i++)
         {
-            us1L[i] = us1L[i] * wet + us2L[i] * dry;
-            us1R[i] = us1R[i] * wet + us2R[i] * dry;
+            dataL[i] = dataL[i] * wet + dryL[size_t(i)] * dry;
+            dataR[i] = dataR[i] * wet + dryR[size_t(i)] * dry;
         }
 
-        dsL.process_block(dataL, us1L, numSamples);
-        dsR.process_block(dataR, us1R, numSamples);
-
         highPassPost.process(context);
         postGain.process(context);
     }
@@ -983,6 +963,7 @@ class WaveShaperProcessor
     inline void setWet(float _wet) { wet = _wet; }
     inline void setLPCutoff(float freq) { lpfCutoff.setTargetValue(freq); }
     inline void setFunctionToUse(int function) { currentFunction = function; }
+    [[nodiscard]] inline bool isSmoothing() const { return drive.isSmoothing() || lpfCutoff.isSmoothing(); }
 
     inline void setGain(float pre, float post)
     {
@@ -1095,10 +1076,7 @@ class WaveShaperProcessor
 
   private:
     juce::AudioBuffer<float> inBuffer;
-    float us1L[MINI_BLOCK_SIZE * 2]{0.f}; // upsampled buffer to be processed
-    float us1R[MINI_BLOCK_SIZE * 2]{0.f};
-    float us2L[MINI_BLOCK_SIZE * 2]{0.f}; // copy to be mixed wet/dry
-    float us2R[MINI_BLOCK_SIZE * 2]{0.f};
+    std::vector<float> dryL, dryR; // copy to be mixed wet/dry, sized in prepare()
 
     using Filter = juce::dsp::IIR::Filter<float>;
     using Coefficients = juce::dsp::IIR::Coefficients<float>;
@@ -1112,20 +1090,6 @@ class WaveShaperProcessor
     double upsampledRate{88200.0};
     int currentFunction = 0; // to trigger a change on first setFunctionToUse call
     float dry{0.5f}, wet{0.5f};
-
-    static constexpr int nbr_coefs1 = 8; // up/down-sampler coefs
-    double coefs1[nbr_coefs1]{0.044076093956155402, 0.16209555156378622, 0.32057678606990592, 0.48526821501990786,
-                              0.63402005787429128,  0.75902855561016014, 0.86299283427175177, 0.9547836337311687};
-
-#if USE_NEON
-    hiir::Downsampler2xNeon<nbr_coefs1> dsL, dsR;
-    hiir::Upsampler2xNeon<nbr_coefs1> usL, usR;
-#endif
-
-#if USE_SSE
-    hiir::Upsampler2xSse<nbr_coefs1> usL, usR;
-    hiir::Downsampler2xSse<nbr_coefs1> dsL, dsR;
-#endif
 };
 
 class RingModulator
@@ -1147,10 +1111,6 @@ class RingModulator
         oversampledSampleRate = sampleRate * oversampleRatio;
         const juce::dsp::ProcessSpec oversampledSpec{oversampledSampleRate, static_cast<juce::uint32>(spec.maximumBlockSize * oversampleRatio),
                                                      static_cast<juce::uint32>(2)};
-        const auto samplesPerBlock = spec.maximumBlockSize * oversampleRatio;
-        constexpr auto filterType = juce::dsp::Oversampling<float>::filterHalfBandFIREquiripple;
-        oversampler = std::make_unique<juce::dsp::Oversampling<float>>(spec.numChannels, oversampleOrder, filterType);
-        oversampler->initProcessing((size_t)samplesPerBlock);
         mod1LPCutoff.reset(sampleRate * oversampleRatio, 0.02f);
         mod2LPCutoff.reset(sampleRate * oversampleRatio, 0.02f);
         LP1.prepare(oversampledSpec);
@@ -1190,14 +1150,13 @@ class RingModulator
         lowCut2.setType(juce::dsp::StateVariableTPTFilterType::highpass);
         lowCut3.setType(juce::dsp::StateVariableTPTFilterType::highpass);
         lowCut4.setType(juce::dsp::StateVariableTPTFilterType::highpass);
-        // do something with this, like report it to processor --->
-        // setLatencySamples((int)oversampler->getLatencyInSamples());
     }
 
+    // 'context' is at twice the host rate: the lane runs this inside an OversampledSection
     void process(const juce::dsp::ProcessContextReplacing<float> &context)
     {
-        const auto numSamples = context.getOutputBlock().getNumSamples();
-        const auto oversampledBlock = oversampler->processSamplesUp(context.getOutputBlock());
+        const auto &oversampledBlock = context.getOutputBlock();
+        const auto numSamples = oversampledBlock.getNumSamples() / static_cast<size_t>(oversampleRatio);
 
         // 1. prepare derived parameters
         juce::dsp::SIMDRegister<float> mod1freqs{params.mod1freq}, mod2freqs{params.mod2freq};
@@ -1347,9 +1306,6 @@ class RingModulator
         lowCut2.setCutoffFrequency(params.lowcut);
         lowCut3.setCutoffFrequency(params.lowcut);
         lowCut4.setCutoffFrequency(params.lowcut);
-
-        // processed that buffer: downsample it, and SHIP IT OUT!
-        oversampler->processSamplesDown(context.getOutputBlock());
     }
 
   private:
@@ -1373,8 +1329,7 @@ class RingModulator
     }
 
     // internal storage / utility
-    std::unique_ptr<juce::dsp::Oversampling<float>> oversampler;
-    int oversampleOrder{1}, oversampleRatio{2};
+    int oversampleRatio{2};
     double oversampledSampleRate{sampleRate * oversampleRatio};
     double inverseOversampledSampleRate{1.0 / oversampledSampleRate};
     RingModParams params;
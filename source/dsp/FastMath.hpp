@@ -43,6 +43,7 @@ SOFTWARE.
 
 #define _USE_MATH_DEFINES
 #include <juce_dsp/juce_dsp.h>
+#include <bit>
 #include <cmath>
 #include <numbers>
 
@@ -85,6 +86,15 @@ template <class F> class FastMath
                                        x2 * (2.75239710746326498401791551303359689e-6f - 2.3868346521031027639830001794722295e-8f * x2)))));
     }
 
+    // 2^x, good to a few parts per million (well under a hundredth of a cent as a pitch ratio)
+    static inline float fastExp2(const float x)
+    {
+        const float whole = std::round(juce::jlimit(-126.0f, 127.0f, x));
+        const float f = x - whole; // [-0.5, 0.5]
+        const float p = 1.0f + f * (0.693147180f + f * (0.240226507f + f * (0.0555041087f + f * (0.00961812911f + f * 0.00133335581f))));
+        return p * std::bit_cast<float>(static_cast<int32_t>(whole + 127.0f) << 23);
+    }
+
     static inline float normalizePhase(float x1)
     { // set anything to [-pi, pi]
         while (x1 > juce::MathConstants<float>::pi)
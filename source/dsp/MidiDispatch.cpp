@@ -0,0 +1,134 @@
+#include "MidiDispatch.h"
+#include <bit>
+#include "PMProcessor.h"
+
+void MidiDispatch::addVoice(PMVoice &voice)
+{
+    jassert(voice.voiceIndex >= 0 && voice.voiceIndex < maxVoices);
+    voices[size_t(voice.voiceIndex)] = &voice;
+}
+
+void MidiDispatch::noteStarted(const PMVoice &voice, const int note)
+{
+    noteStopped(voice); // a stolen voice is still down as playing its old note
+    const auto i = size_t(voice.voiceIndex);
+    voiceNotes[i] = int8_t(note & 127);
+    noteVoices[size_t(note & 127)] |= uint64_t(1) << i;
+}
+
+void MidiDispatch::noteStopped(const PMVoice &voice)
+{
+    const auto i = size_t(voice.voiceIndex);
+    if (voiceNotes[i] >= 0)
+        noteVoices[size_t(voiceNotes[i])] &= ~(uint64_t(1) << i);
+    voiceNotes[i] = -1;
+}
+
+void MidiDispatch::handlePolyAftertouch(const int note, const float value)
+{
+    for (auto mask = noteVoices[size_t(note & 127)]; mask != 0; mask &= mask - 1)
+        proc.routing.setPolyValue(*voices[size_t(std::countr_zero(mask))], proc.modPolyAT, value);
+}
+
+void MidiDispatch::updateRouting()
+{
+    const auto &mp = proc.macroParams;
+    const std::array<int, numMacros> current{mp.macro1cc->getUserValueInt(), mp.macro2cc->getUserValueInt(),
+                                             mp.macro3cc->getUserValueInt()};
+    if (current == macroControllers)
+        return;
+
+    for (const int controller : macroControllers)
+    {
+        if (controller >= nrpnBase)
+            nrpnMacros[size_t(controller - nrpnBase)] = 0;
+        else if (controller >= 0)
+            ccMacros[size_t(controller)] = 0;
+    }
+
+    macroControllers = current;
+    for (size_t m = 0; m < numMacros; m++)
+    {
+        const int controller = macroControllers[m];
+        if (controller >= nrpnBase)
+            nrpnMacros[size_t(controller - nrpnBase)] |= uint8_t(1 << m);
+        else if (controller >= 0)
+            ccMacros[size_t(controller)] |= uint8_t(1 << m);
+    }
+}
+
+void MidiDispatch::handleController(const int controller, const int value)
+{
+    if (proc.macroParams.learning->getUserValueInt() > 0)
+        learn(controller);
+
+    switch (controller)
+    {
+    case 99: // NRPN select; 127/127 is the null NRPN, which deselects
+        nrpnMsb = value;
+        nrpn = nrpnMsb == 127 && nrpnLsb == 127 ? -1 : nrpnMsb * 128 + nrpnLsb;
+        return;
+    case 98:
+        nrpnLsb = value;
+        nrpn = nrpnMsb == 127 && nrpnLsb == 127 ? -1 : nrpnMsb * 128 + nrpnLsb;
+        return;
+    case 101: // RPN select, which we don't follow
+    case 100:
+        nrpn = -1;
+        return;
+    case 6: // data entry, for the selected NRPN if a macro follows it, otherwise a plain CC
+        if (nrpn >= 0 && nrpnMacros[size_t(nrpn)] != 0)
+        {
+            dataMsb = value;
+            setMacros(nrpnMacros[size_t(nrpn)], float(value) / 127.0f);
+            return;
+        }
+        break;
+    case 38:
+        if (nrpn >= 0 && nrpnMacros[size_t(nrpn)] != 0)
+        {
+            setMacros(nrpnMacros[size_t(nrpn)], float(dataMsb * 128 + value) / 16383.0f);
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (controller < 32)
+        ccMsb[size_t(controller)] = uint8_t(value);
+    setMacros(ccMacros[size_t(controller)], float(value) / 127.0f);
+
+    // the LSB of a 14-bit pair refines whatever follows its MSB
+    if (controller >= 32 && controller < 64)
+        setMacros(ccMacros[size_t(controller - 32)], float(ccMsb[size_t(controller - 32)] * 128 + value) / 16383.0f);
+}
+
+void MidiDispatch::learn(const int controller)
+{
+    if (controller >= 98 && controller <= 101)
+        return; // wait for the data entry that follows
+    const bool dataEntry = controller == 6 || controller == 38;
+    const int learned = dataEntry && nrpn >= 0 ? nrpnBase + nrpn : controller;
+
+    auto &mp = proc.macroParams;
+    const std::array<gin::Parameter *, numMacros> ccParams{mp.macro1cc, mp.macro2cc, mp.macro3cc};
+    if (const int n = mp.learning->getUserValueInt(); n <= numMacros)
+        ccParams[size_t(n - 1)]->setUserValue(float(learned));
+    mp.learning->setValue(0.f);
+    updateRouting();
+}
+
+void MidiDispatch::setMacros(const uint8_t mask, const float value)
+{
+    if (mask == 0)
+        return;
+
+    auto &mp = proc.macroParams;
+    const std::array<gin::Parameter *, numMacros> macros{mp.macro1, mp.macro2, mp.macro3};
+    for (size_t m = 0; m < numMacros; m++)
+    {
+        if (mask & (1 << m))
+            macros[m]->setValue(value);
+    }
+}
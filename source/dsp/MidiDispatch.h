@@ -0,0 +1,66 @@
+/*
+ * PM Daze - an expressive, semi-modular, phase-modulation synthesizer
+ *
+ * Copyright 2025, Greg Recco
+ *
+ * PM Daze is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source code for PM Daze is available at
+ * https://github.com/gregrecco67/PMDaze
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+class PMProcessor;
+class PMVoice;
+
+//==============================================================================
+// Lookup tables that route incoming MIDI in constant time: which voices are
+// playing each note, for poly aftertouch, and which macros each controller
+// drives. The note table follows the voices as they start and stop. The
+// controller tables are rebuilt when a macro's controller is learned or
+// changed.
+//
+// Macros can follow a plain CC, a 14-bit CC pair (CC 0-31 with its LSB at
+// CC 32-63) or an NRPN. A macro's controller parameter holds the CC number,
+// or 128 + the NRPN number.
+class MidiDispatch
+{
+  public:
+    static constexpr int maxVoices = 64, numMacros = 3;
+    static constexpr int nrpnBase = 128, numNrpns = 128 * 128;
+
+    explicit MidiDispatch(PMProcessor &p) : proc(p) { voiceNotes.fill(-1); }
+
+    void addVoice(PMVoice &voice);
+
+    // audio thread
+    void noteStarted(const PMVoice &voice, int note);
+    void noteStopped(const PMVoice &voice);
+    void updateRouting(); // once per block; rebuilds the controller tables if a macro's controller changed
+    void handleController(int controller, int value);
+    void handlePolyAftertouch(int note, float value);
+
+  private:
+    void learn(int controller);
+    void setMacros(uint8_t mask, float value);
+
+    PMProcessor &proc;
+
+    std::array<PMVoice *, maxVoices> voices{}; // by voice index
+    std::array<uint64_t, 128> noteVoices{}; // a bit per voice playing each note
+    std::array<int8_t, maxVoices> voiceNotes; // -1 when idle
+
+    std::array<int, numMacros> macroControllers{-1, -1, -1};
+    std::array<uint8_t, 128> ccMacros{};       // a bit per macro following each CC
+    std::array<uint8_t, numNrpns> nrpnMacros{}; // and each NRPN
+    std::array<uint8_t, 32> ccMsb{};            // last MSB of each 14-bit pair
+    int nrpn{-1};                               // the selected NRPN, or -1
+    int nrpnMsb{0}, nrpnLsb{0}, dataMsb{0};
+};
@@ -0,0 +1,65 @@
+/*
+ * PM Daze - an expressive, semi-modular, phase-modulation synthesizer
+ *
+ * Copyright 2025, Greg Recco
+ *
+ * PM Daze is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source code for PM Daze is available at
+ * https://github.com/gregrecco67/PMDaze
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+
+//==============================================================================
+// ModFM turns a modulator's output x into exp(x) * 0.850918 - 1.313035.
+// For sine modulators the whole thing is tabulated over phase; for the
+// band-limited waves the exp() is tabulated over the oscillator's output,
+// which stays within [-1, 1] apart from a little Gibbs overshoot.
+class ModFMTables
+{
+  public:
+    static constexpr int sineSize = 4096;
+    static constexpr int shapeSize = 4096;
+    static constexpr float shapeMin = -1.5f, shapeMax = 1.5f;
+
+    static inline float modfm(const double x) { return static_cast<float>(std::exp(x) * 0.850918 - 1.313035); }
+
+    void build()
+    {
+        for (size_t i = 0; i <= sineSize; i++)
+            sineTable[i] = modfm(std::sin(2.0 * std::numbers::pi * double(i) / double(sineSize)));
+        for (size_t i = 0; i <= shapeSize; i++)
+            shapeTable[i] = modfm(shapeMin + (shapeMax - shapeMin) * double(i) / double(shapeSize));
+    }
+
+    // phase in [0, 1)
+    [[nodiscard]] inline float sine(const float phase) const
+    {
+        const float pos = phase * float(sineSize);
+        const auto i = std::min(static_cast<size_t>(pos), size_t(sineSize - 1));
+        const float frac = pos - float(i);
+        return sineTable[i] + frac * (sineTable[i + 1] - sineTable[i]);
+    }
+
+    // x is an oscillator output
+    [[nodiscard]] inline float shape(const float x) const
+    {
+        const float pos = (std::clamp(x, shapeMin, shapeMax) - shapeMin) * (float(shapeSize) / (shapeMax - shapeMin));
+        const auto i = std::min(static_cast<size_t>(pos), size_t(shapeSize - 1));
+        const float frac = pos - float(i);
+        return shapeTable[i] + frac * (shapeTable[i + 1] - shapeTable[i]);
+    }
+
+  private:
+    std::array<float, sineSize + 1> sineTable{};   // last entry wraps around
+    std::array<float, shapeSize + 1> shapeTable{}; // last entry is shapeMax
+};
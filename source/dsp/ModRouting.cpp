@@ -0,0 +1,131 @@
+#include "ModRouting.h"
+#include "PMVoice.h"
+
+ModRouting::~ModRouting() { modMatrix.removeListener(this); }
+
+void ModRouting::setup(const std::vector<gin::Parameter *> &polyParams)
+{
+    params = polyParams;
+    numSources = modMatrix.getNumModSources();
+
+    numParams = 0;
+    for (const auto *p : params)
+        numParams = std::max(numParams, p->getModIndex() + 1);
+    isPolyParam.assign(size_t(numParams), false);
+    for (const auto *p : params)
+        isPolyParam[size_t(p->getModIndex())] = true;
+
+    values.assign(size_t(maxVoices * numParams), 0.0f);
+    smoothed.assign(size_t(maxVoices * numParams), 0.0f);
+    polySources.assign(size_t(maxVoices * numSources), 0.0f);
+    monoSources.assign(size_t(numSources), 0.0f);
+
+    compile(live);
+    modMatrix.addListener(this);
+}
+
+void ModRouting::setPolyValue(PMVoice &voice, const gin::ModSrcId src, const float value)
+{
+    polySources[size_t(voice.voiceIndex * numSources + src.id)] = value;
+    modMatrix.setPolyValue(voice, src, value);
+}
+
+// one source for many voices, e.g. a ModulatorBank slot; 'byVoiceIndex' holds a value for each voice index
+void ModRouting::setPolyValues(PMVoice *const *voices, const int numVoices, const gin::ModSrcId src, const float *byVoiceIndex)
+{
+    for (int v = 0; v < numVoices; v++)
+    {
+        auto &voice = *voices[v];
+        const float value = byVoiceIndex[voice.voiceIndex];
+        polySources[size_t(voice.voiceIndex * numSources + src.id)] = value;
+        modMatrix.setPolyValue(voice, src, value);
+    }
+}
+
+void ModRouting::setMonoValue(const gin::ModSrcId src, const float value)
+{
+    monoSources[size_t(src.id)] = value;
+    modMatrix.setMonoValue(src, value);
+}
+
+void ModRouting::modMatrixChanged()
+{
+    Table table;
+    compile(table);
+    {
+        const juce::SpinLock::ScopedLockType sl(pendingLock);
+        std::swap(pending, table);
+        pendingReady = true;
+    }
+    // the table swapped out is freed here, on the message thread
+}
+
+void ModRouting::compile(Table &table) const
+{
+    table.routed.assign(size_t(numParams), false);
+    for (auto *p : params)
+    {
+        const gin::ModDstId dst(p->getModIndex());
+        const auto first = table.routes.size();
+        for (const auto &[src, depth] : modMatrix.getModDepths(dst))
+        {
+            if (!modMatrix.getModEnable(src, dst))
+                continue;
+            table.routes.push_back({src.id, depth, modMatrix.getModFunction(src, dst), modMatrix.getModSrcPoly(src),
+                                    modMatrix.getModSrcBipolar(src), modMatrix.getModBipolarMapping(src, dst)});
+        }
+        if (table.routes.size() > first)
+        {
+            table.destinations.push_back({p, first, table.routes.size() - first});
+            table.routed[size_t(p->getModIndex())] = true;
+        }
+    }
+}
+
+void ModRouting::evaluate(PMVoice *const *voices, const int numVoices, const double seconds)
+{
+    if (pendingReady.load(std::memory_order_acquire))
+    {
+        const juce::SpinLock::ScopedLockType sl(pendingLock);
+        std::swap(live, pending);
+        pendingReady = false;
+        snapNext = true;
+    }
+
+    const auto maxStep = static_cast<float>(seconds / smoothingTime);
+
+    for (const auto &d : live.destinations)
+    {
+        const float base = d.param->getValue();
+        const auto range = d.param->getUserRange();
+        const auto *routes = live.routes.data() + d.firstRoute;
+        const int modIndex = d.param->getModIndex();
+
+        for (int v = 0; v < numVoices; v++)
+        {
+            const auto *voice = voices[v];
+            const int voiceIndex = voice->voiceIndex;
+            const float *voiceSources = polySources.data() + voiceIndex * numSources;
+
+            float n = base;
+            for (size_t r = 0; r < d.numRoutes; r++)
+            {
+                const auto &route = routes[r];
+                const float s = route.poly ? voiceSources[route.src] : monoSources[size_t(route.src)];
+                n += gin::ModMatrix::shape(s, route.function, route.bipolarSrc, route.bipolarMapping) * route.depth;
+            }
+            n = juce::jlimit(0.0f, 1.0f, n);
+
+            const auto idx = size_t(voiceIndex * numParams + modIndex);
+            auto &current = smoothed[idx];
+            if (snapNext || voice->disableSmoothing)
+                current = n;
+            else
+                current += juce::jlimit(-maxStep, maxStep, n - current);
+
+            const float user = range.convertFrom0to1(current);
+            values[idx] = d.param->conversionFunction ? d.param->conversionFunction(user) : user;
+        }
+    }
+    snapNext = false;
+}
@@ -0,0 +1,106 @@
+/*
+ * PM Daze - an expressive, semi-modular, phase-modulation synthesizer
+ *
+ * Copyright 2025, Greg Recco
+ *
+ * PM Daze is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source code for PM Daze is available at
+ * https://github.com/gregrecco67/PMDaze
+ */
+
+#pragma once
+
+#include <gin_plugin/gin_plugin.h>
+#include <atomic>
+#include <vector>
+
+class PMVoice;
+
+//==============================================================================
+// The mod matrix's routings into the per-voice parameters, compiled into a
+// flat list of (source, depth, curve) entries per modulated destination.
+// On each control tick every voice's modulated parameters are worked out in
+// one pass over that list, instead of each parameter going through the mod
+// matrix on its own.
+//
+// The list is compiled on the message thread whenever the routing changes
+// and swapped in by the audio thread at the next tick. Source values are
+// mirrored here as they're set, so all source changes have to go through
+// setPolyValue() and setMonoValue() rather than the mod matrix directly.
+//
+// Like the mod matrix's own voices, each voice's modulated values glide to
+// their new targets, at full range per 20 ms, except while the voice has
+// smoothing disabled (as it does while a note starts).
+class ModRouting : private gin::ModMatrix::Listener
+{
+  public:
+    static constexpr int maxVoices = 64;
+
+    explicit ModRouting(gin::ModMatrix &m) : modMatrix(m) {}
+    ~ModRouting() override;
+
+    // after the mod matrix is built; 'polyParams' are the parameters voices own
+    void setup(const std::vector<gin::Parameter *> &polyParams);
+
+    void setPolyValue(PMVoice &voice, gin::ModSrcId src, float value);
+    void setPolyValues(PMVoice *const *voices, int numVoices, gin::ModSrcId src, const float *byVoiceIndex);
+    void setMonoValue(gin::ModSrcId src, float value);
+
+    // audio thread, once per control tick, after the voices' sources are set;
+    // 'seconds' is how long the values last, until the next tick
+    void evaluate(PMVoice *const *voices, int numVoices, double seconds);
+
+    // true if this parameter's per-voice value comes from here
+    [[nodiscard]] inline bool isPoly(const gin::Parameter *p) const { return isPolyParam[size_t(p->getModIndex())]; }
+    [[nodiscard]] inline bool isRouted(const gin::Parameter *p) const { return live.routed[size_t(p->getModIndex())]; }
+    [[nodiscard]] inline float value(const int voiceIndex, const gin::Parameter *p) const
+    {
+        return values[size_t(voiceIndex * numParams + p->getModIndex())];
+    }
+
+  private:
+    static constexpr double smoothingTime = 0.02;
+
+    struct Route
+    {
+        int src;
+        float depth;
+        gin::ModMatrix::Function function;
+        bool poly, bipolarSrc, bipolarMapping;
+    };
+    struct Destination
+    {
+        gin::Parameter *param;
+        size_t firstRoute, numRoutes;
+    };
+    struct Table
+    {
+        std::vector<Destination> destinations;
+        std::vector<Route> routes;
+        std::vector<bool> routed; // by mod index
+    };
+
+    void modMatrixChanged() override;
+    void compile(Table &table) const;
+
+    gin::ModMatrix &modMatrix;
+    std::vector<gin::Parameter *> params;
+    std::vector<bool> isPolyParam;
+    int numParams{0}, numSources{0};
+
+    Table live, pending;
+    juce::SpinLock pendingLock;
+    std::atomic<bool> pendingReady{false};
+    bool snapNext{true}; // a new table's destinations start at their targets
+
+    std::vector<float> values;      // [voice][mod index], in user units
+    std::vector<float> smoothed;    // [voice][mod index], normalised
+    std::vector<float> polySources; // [voice][source]
+    std::vector<float> monoSources; // [source]
+
+    JUCE_DECLARE_NON_COPYABLE(ModRouting)
+};
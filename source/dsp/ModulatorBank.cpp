@@ -0,0 +1,237 @@
+#include "ModulatorBank.h"
+#include "PMProcessor.h"
+#include <cmath>
+
+static_assert(ModulatorBank::maxVoices >= VoiceBank::maxVoices);
+static_assert(ModulatorBank::maxVoices % ModulatorBank::numLanes == 0);
+
+// each wave sampled once from a gin::LFO held at a phase, at full depth
+const std::array<ModulatorBank::Table, ModulatorBank::numShapes> &ModulatorBank::shapeTables()
+{
+    static const auto tables = [] {
+        std::array<Table, numShapes> t{};
+        gin::LFO lfo;
+        lfo.setSampleRate(1000.0);
+        for (int s = 0; s < numShapes; s++)
+        {
+            gin::LFO::Parameters params;
+            params.waveShape = static_cast<gin::LFO::WaveShape>(s);
+            params.frequency = 0.0f;
+            params.depth = 1.0f;
+            for (int i = 0; i <= tableSize; i++)
+            {
+                params.phase = static_cast<float>(i % tableSize) / tableSize;
+                lfo.setParameters(params);
+                lfo.reset();
+                lfo.noteOn();
+                t[size_t(s)][size_t(i)] = lfo.process(1);
+            }
+        }
+        return t;
+    }();
+    return tables;
+}
+
+void ModulatorBank::setControlRate(const int voiceIndex, const double rate) { rates[size_t(voiceIndex)] = static_cast<float>(rate); }
+
+void ModulatorBank::resetLFOs(const int voiceIndex)
+{
+    const auto v = size_t(voiceIndex);
+    for (auto &l : lfos)
+    {
+        l.phase[v] = 0.0f;
+        l.current[v] = 0.0f;
+        l.fade[v] = 1.0f;
+        l.fadeDelta[v] = 0.0f;
+        l.delayLeft[v] = 0.0f;
+        l.output[v] = 0.0f;
+    }
+}
+
+void ModulatorBank::startLFOs(const int voiceIndex)
+{
+    const auto v = size_t(voiceIndex);
+    for (auto &l : lfos)
+    {
+        // a positive fade fades in from nothing, a negative one out from full depth
+        const float fadeTime = l.fadeTime[v];
+        l.fade[v] = fadeTime > 0.0f ? 0.0f : 1.0f;
+        l.fadeDelta[v] = fadeTime != 0.0f ? 1.0f / (rates[v] * fadeTime) : 0.0f;
+        l.delayLeft[v] = std::round(rates[v] * l.delay[v]);
+        l.held[v] = random.nextFloat() * 2.0f - 1.0f;
+    }
+}
+
+void ModulatorBank::process(PMVoice *const *voices, const int numVoices, const int blockSize)
+{
+    jassert(numVoices <= maxVoices);
+
+    processLFOs(voices, numVoices, blockSize);
+    processMSEGs(voices, numVoices, blockSize);
+}
+
+void ModulatorBank::processLFOs(PMVoice *const *voices, const int numVoices, const int blockSize)
+{
+    const auto &snapshot = proc.snapshot;
+    const auto &transport = proc.transport;
+    const auto &tables = shapeTables();
+
+    // every lane up to the highest voice playing is run, the idle ones along with the rest
+    int end = 0;
+    for (int v = 0; v < numVoices; v++)
+        end = std::max(end, voices[v]->voiceIndex + 1);
+    const auto count = size_t((end + numLanes - 1) / numLanes * numLanes);
+
+    const Lanes zero(0.0f), one(1.0f), steps(static_cast<float>(blockSize));
+
+    for (size_t slot = 0; slot < 4; slot++)
+    {
+        const auto &lp = *proc.lfoParamsByNum[slot];
+        auto &l = lfos[slot];
+        const bool sync = lp.sync->getUserValue() > 0.0f;
+        const int shape = juce::jlimit(0, numShapes - 1, lp.wave->getUserValueInt());
+
+        // this tick's settings: the shared values, then those of the voices that modulate them
+        std::fill_n(l.frequency.begin(), count, sync ? transport.noteRate(lp.beat->getUserValue()) : snapshot.value(lp.rate));
+        std::fill_n(l.phaseOffset.begin(), count, snapshot.value(lp.phase));
+        std::fill_n(l.offset.begin(), count, snapshot.value(lp.offset));
+        std::fill_n(l.depth.begin(), count, snapshot.value(lp.depth));
+        std::fill_n(l.delay.begin(), count, snapshot.value(lp.delay));
+        std::fill_n(l.fadeTime.begin(), count, snapshot.value(lp.fade));
+
+        const bool perVoice = (!sync && snapshot.isModulated(lp.rate)) || snapshot.isModulated(lp.phase) || snapshot.isModulated(lp.offset) ||
+                              snapshot.isModulated(lp.depth) || snapshot.isModulated(lp.delay) || snapshot.isModulated(lp.fade);
+        if (perVoice)
+        {
+            for (int v = 0; v < numVoices; v++)
+            {
+                auto *voice = voices[v];
+                const auto i = size_t(voice->voiceIndex);
+                if (!sync)
+                    l.frequency[i] = voice->param(lp.rate);
+                l.phaseOffset[i] = voice->param(lp.phase);
+                l.offset[i] = voice->param(lp.offset);
+                l.depth[i] = voice->param(lp.depth);
+                l.delay[i] = voice->param(lp.delay);
+                l.fadeTime[i] = voice->param(lp.fade);
+            }
+        }
+
+        // the delay holds an LFO still; after that its fade and phase move on for the rest of the block
+        for (size_t i = 0; i < count; i += numLanes)
+        {
+            const auto delayLeft = Lanes::fromRawArray(l.delayLeft.data() + i);
+            const auto run = Lanes::max(zero, steps - delayLeft);
+            Lanes::max(zero, delayLeft - steps).copyToRawArray(l.delayLeft.data() + i);
+
+            const auto fade = Lanes::fromRawArray(l.fade.data() + i) + Lanes::fromRawArray(l.fadeDelta.data() + i) * run;
+            Lanes::min(one, Lanes::max(zero, fade)).copyToRawArray(l.fade.data() + i);
+
+            // lanes that are stopped, or whose voice hasn't been clocked yet, hold their phase
+            const auto frequency = Lanes::fromRawArray(l.frequency.data() + i);
+            const auto rate = Lanes::fromRawArray(rates.data() + i);
+            const auto moving = Lanes::greaterThan(frequency, Lanes(0.0001f)) & Lanes::greaterThan(rate, zero);
+            const auto step = (frequency / Lanes::max(one, rate)) & moving;
+            (Lanes::fromRawArray(l.phase.data() + i) + step * run).copyToRawArray(l.phase.data() + i);
+        }
+
+        // a fast LFO at a coarse control rate can pass more than one cycle in a tick
+        for (size_t i = 0; i < count; i++)
+        {
+            wrapped[i] = std::floor(l.phase[i]);
+            l.phase[i] -= wrapped[i];
+
+            // the phase offset is -1 to 1, so one wrap either way brings the point read back into 0 to 1
+            float current = l.phase[i] + l.phaseOffset[i];
+            if (current < 0.0f)
+                current += 1.0f;
+            else if (current >= 1.0f)
+                current -= 1.0f;
+            l.current[i] = current;
+        }
+
+        // the wave at each lane's point, from its table, or at random
+        switch (static_cast<gin::LFO::WaveShape>(shape))
+        {
+        case gin::LFO::WaveShape::sampleAndHold:
+            for (size_t i = 0; i < count; i++)
+            {
+                if (wrapped[i] > 0.0f)
+                    l.held[i] = random.nextFloat() * 2.0f - 1.0f;
+                values[i] = l.held[i];
+            }
+            break;
+        case gin::LFO::WaveShape::noise:
+            for (size_t i = 0; i < count; i++)
+                values[i] = random.nextFloat() * 2.0f - 1.0f;
+            break;
+        default:
+        {
+            const auto &table = tables[size_t(shape)];
+            for (size_t i = 0; i < count; i++)
+            {
+                const float x = l.current[i] * tableSize;
+                const auto j = std::min(size_t(x), size_t(tableSize - 1));
+                values[i] = table[j] + (table[j + 1] - table[j]) * (x - static_cast<float>(j));
+            }
+            break;
+        }
+        }
+
+        for (size_t i = 0; i < count; i += numLanes)
+        {
+            const auto out = Lanes::fromRawArray(values.data() + i) * Lanes::fromRawArray(l.depth.data() + i) * Lanes::fromRawArray(l.fade.data() + i) +
+                             Lanes::fromRawArray(l.offset.data() + i);
+            Lanes::min(one, Lanes::max(Lanes(-1.0f), out)).copyToRawArray(l.output.data() + i);
+        }
+
+        proc.routing.setPolyValues(voices, numVoices, *proc.polyLfoIds[slot], l.output.data());
+    }
+}
+
+void ModulatorBank::processMSEGs(PMVoice *const *voices, const int numVoices, const int blockSize)
+{
+    const auto &snapshot = proc.snapshot;
+    const auto &transport = proc.transport;
+
+    for (size_t slot = 0; slot < 4; slot++)
+    {
+        const auto &mp = *proc.msegParamsByNum[slot];
+        const bool sync = mp.sync->isOn();
+        auto &outputs = msegOutputs[slot];
+
+        gin::MSEG::Parameters shared;
+        if (sync)
+            shared.frequency = transport.noteRate(snapshot.value(mp.beat));
+        else
+            shared.frequency = snapshot.value(mp.rate);
+        shared.depth = snapshot.value(mp.depth);
+        shared.offset = snapshot.value(mp.offset);
+        shared.loop = mp.loop->isOn();
+
+        const bool perVoice = snapshot.isModulated(sync ? mp.beat : mp.rate) || snapshot.isModulated(mp.depth) || snapshot.isModulated(mp.offset);
+
+        for (int v = 0; v < numVoices; v++)
+        {
+            auto *voice = voices[v];
+            auto &params = *voice->msegParams[slot];
+            params = shared;
+            if (perVoice)
+            {
+                if (sync)
+                    params.frequency = transport.noteRate(voice->param(mp.beat));
+                else
+                    params.frequency = voice->param(mp.rate);
+                params.depth = voice->param(mp.depth);
+                params.offset = voice->param(mp.offset);
+            }
+
+            auto &mseg = *voice->msegs[slot];
+            mseg.setParameters(params);
+            mseg.process(blockSize);
+            outputs[size_t(voice->voiceIndex)] = mseg.getOutput();
+        }
+
+        proc.routing.setPolyValues(voices, numVoices, *proc.msegSrcIds[slot], outputs.data());
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ * PM Daze - an expressive, semi-modular, phase-modulation synthesizer
+ *
+ * Copyright 2025, Greg Recco
+ *
+ * PM Daze is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source code for PM Daze is available at
+ * https://github.com/gregrecco67/PMDaze
+ */
+
+#pragma once
+
+#include <gin_dsp/gin_dsp.h>
+#include <juce_dsp/juce_dsp.h>
+#include <array>
+
+class PMProcessor;
+class PMVoice;
+
+//==============================================================================
+// Updates the poly LFOs and MSEGs of many voices at once on a control tick.
+//
+// The LFOs live here rather than in the voices, one array per field indexed
+// by voice, and each LFO slot advances every voice's delay, fade and phase in
+// SIMD lanes. Waves are read from tables sampled from gin::LFO itself, so
+// they match what the LFO display draws. Settings no voice modulates are
+// filled in once per slot.
+//
+// The MSEGs are still gin::MSEGs in the voices, since their curves are the
+// user's own points, but they're updated here slot by slot too. Each slot's
+// outputs go to ModRouting in one batch.
+class ModulatorBank
+{
+  public:
+    using Lanes = juce::dsp::SIMDRegister<float>;
+    static constexpr int numLanes = static_cast<int>(Lanes::SIMDNumElements);
+    static constexpr int maxVoices = 64;
+
+    explicit ModulatorBank(PMProcessor &p) : proc(p) {}
+
+    // a voice's LFOs, which the voice clocks, resets and starts
+    void setControlRate(int voiceIndex, double rate);
+    void resetLFOs(int voiceIndex);
+    void startLFOs(int voiceIndex); // with the delays and fades last worked out for the voice
+    [[nodiscard]] float getLFOPhase(const size_t slot, const int voiceIndex) const { return lfos[slot].current[size_t(voiceIndex)]; }
+
+    // audio thread, on a control tick
+    void process(PMVoice *const *voices, int numVoices, int blockSize);
+
+  private:
+    static constexpr int tableSize = 1024;
+    static constexpr int numShapes = static_cast<int>(gin::LFO::WaveShape::pyramid9) + 1;
+    using Table = std::array<float, tableSize + 1>; // the last point is the first again
+    static const std::array<Table, numShapes> &shapeTables();
+
+    struct alignas(64) LFOLanes
+    {
+        // state
+        std::array<float, maxVoices> phase{}, current{}, fade{}, fadeDelta{}, delayLeft{}, held{}, output{};
+        // this tick's settings
+        std::array<float, maxVoices> frequency{}, phaseOffset{}, depth{}, offset{}, delay{}, fadeTime{};
+    };
+
+    void processLFOs(PMVoice *const *voices, int numVoices, int blockSize);
+    void processMSEGs(PMVoice *const *voices, int numVoices, int blockSize);
+
+    PMProcessor &proc;
+    std::array<LFOLanes, 4> lfos;
+    alignas(64) std::array<float, maxVoices> rates{}, wrapped{}, values{};
+    std::array<std::array<float, maxVoices>, 4> msegOutputs{};
+    juce::Random random;
+};
@@ -0,0 +1,114 @@
+/*
+ * PM Daze - an expressive, semi-modular, phase-modulation synthesizer
+ *
+ * Copyright 2025, Greg Recco
+ *
+ * PM Daze is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source code for PM Daze is available at
+ * https://github.com/gregrecco67/PMDaze
+ */
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include <memory>
+#include <vector>
+#include "PolyphaseStereo.h"
+
+//==============================================================================
+// One 2x up/down conversion wrapped around a run of neighbouring effects that
+// need oversampling, so the effects in the run all work on the same 2x signal
+// and the lane only pays for one resampler pair per run.
+//
+// The IIR filter is hiir's polyphase half-band, with a round trip of about
+// three samples. The FIR filter is JUCE's equiripple half-band: linear phase,
+// but heavier and with more delay.
+class OversampledSection
+{
+  public:
+    enum class Filter
+    {
+        iir,
+        fir
+    };
+
+    OversampledSection()
+    {
+        us.setCoefs(coefs, numCoefs);
+        ds.setCoefs(coefs, numCoefs);
+    }
+
+    void prepare(const juce::dsp::ProcessSpec &spec)
+    {
+        const auto maxUp = size_t(spec.maximumBlockSize) * 2;
+        upL.assign(maxUp, 0.0f);
+        upR.assign(maxUp, 0.0f);
+        channels[0] = upL.data();
+        channels[1] = upR.data();
+
+        fir = std::make_unique<juce::dsp::Oversampling<float>>(2, 1, juce::dsp::Oversampling<float>::filterHalfBandFIREquiripple);
+        fir->initProcessing(spec.maximumBlockSize);
+        reset();
+    }
+
+    void reset()
+    {
+        us.clear();
+        ds.clear();
+        if (fir)
+            fir->reset();
+    }
+
+    // switching filters starts the new one from silence
+    void setFilter(const Filter newFilter)
+    {
+        if (newFilter == filter)
+            return;
+        filter = newFilter;
+        reset();
+    }
+
+    // the 2x version of 'block', good until down() is called
+    juce::dsp::AudioBlock<float> up(const juce::dsp::AudioBlock<float> &block)
+    {
+        if (filter == Filter::fir)
+            return fir->processSamplesUp(block);
+
+        const auto numSamples = block.getNumSamples();
+        us.process(upL.data(), upR.data(), block.getChannelPointer(0), block.getChannelPointer(1), int(numSamples));
+        return juce::dsp::AudioBlock<float>(channels, 2, numSamples * 2);
+    }
+
+    // the 2x signal, after the run's effects, back into 'block'
+    void down(juce::dsp::AudioBlock<float> &block)
+    {
+        if (filter == Filter::fir)
+            fir->processSamplesDown(block);
+        else
+            ds.process(block.getChannelPointer(0), block.getChannelPointer(1), upL.data(), upR.data(), int(block.getNumSamples()));
+    }
+
+    // the round trip's delay at DC through either filter, in host samples
+    [[nodiscard]] double getLatency(const Filter withFilter) const
+    {
+        if (withFilter == Filter::fir)
+            return fir ? static_cast<double>(fir->getLatencyInSamples()) : 0.0;
+        return us.getDelay() + ds.getDelay();
+    }
+
+  private:
+    static constexpr int numCoefs = 8;
+    static constexpr double coefs[numCoefs]{0.044076093956155402, 0.16209555156378622, 0.32057678606990592, 0.48526821501990786,
+                                            0.63402005787429128,  0.75902855561016014, 0.86299283427175177, 0.9547836337311687};
+
+    Filter filter{Filter::iir};
+    StereoUpsampler2x us;
+    StereoDownsampler2x ds;
+    std::unique_ptr<juce::dsp::Oversampling<float>> fir;
+    std::vector<float> upL, upR;
+    float *channels[2]{}; // the block up() returns points here
+};
@@ -29,6 +29,33 @@ static juce::String fmTypeTextFunction(const gin::Parameter &, float v)
     }
 }
 
+static juce::String oversamplingTextFunction(const gin::Parameter &, float v)
+{
+    switch (int(v))
+    {
+    case 0:
+        return "Auto";
+    case 1:
+        return "1x";
+    case 2:
+        return "2x";
+    case 3:
+        return "4x";
+    case 4:
+        return "8x";
+    default:
+        return "4x";
+    }
+}
+
+static juce::String synthBlockTextFunction(const gin::Parameter &, float v) { return juce::String(16 << int(v)); }
+
+static juce::String fxBlockTextFunction(const gin::Parameter &, float v) { return juce::String(32 << int(v)); }
+
+static juce::String decimationTextFunction(const gin::Parameter &, float v) { return int(v) == 1 ? "Linear Phase" : "Low Latency"; }
+
+static juce::String rmOversamplingTextFunction(const gin::Parameter &, float v) { return int(v) == 1 ? "IIR" : "FIR"; }
+
 static juce::String ladderTypeTextFunction(const gin::Parameter &, float v)
 {
     switch (static_cast<int>(v))
@@ -125,6 +152,32 @@ static juce::String durationTextFunction(const gin::Parameter &, float v) { retu
 
 static juce::String percentTextFunction(const gin::Parameter &, float v) { return juce::String(static_cast<int>(v * 1000.0f) / 10.f) + "%"; }
 
+static juce::String controlRateTextFunction(const gin::Parameter &, float v)
+{
+    switch (static_cast<int>(v))
+    {
+    case 0:
+        return "Every Block";
+    case 1:
+        return "Every 2nd";
+    case 2:
+        return "Every 4th";
+    case 3:
+        return "Every 8th";
+    default:
+        jassertfalse;
+        return {};
+    }
+}
+
+static juce::String panTextFunction(const gin::Parameter &, float v)
+{
+    const int amount = juce::roundToInt(v * 100.0f);
+    if (amount == 0)
+        return "C";
+    return (amount < 0 ? "L" : "R") + juce::String(std::abs(amount));
+}
+
 static juce::String compressorTypeTextFunction(const gin::Parameter &, float v)
 {
     switch (static_cast<int>(v))
@@ -567,6 +620,8 @@ void PMProcessor::GlobalParams::setup(PMProcessor &p)
     velSens = p.addExtParam("velSens", "Vel. Sens.", "", "%", {0.0, 100.0, 0.0, 1.0}, 100.0, 0.05f);
     modTone = p.addExtParam("modTone", "Mod Tone", "", "", {0.0, 1.0, 0.0, 1.0}, 0.5f, 0.07f, percentTextFunction);
     modIndex = p.addExtParam("modIndex", "Mod Index", "", "", {4.0, 28.0, 0.0, 1.0}, 12.0f, 0.07f);
+    pan = p.addExtParam("pan", "Pan", "", "", {-1.0, 1.0, 0.0, 1.0}, 0.0f, 0.05f, panTextFunction);
+    spread = p.addExtParam("spread", "Spread", "", "", {0.0, 1.0, 0.0, 1.0}, 0.0f, 0.05f, percentTextFunction);
     mono = p.addIntParam("mono", "Mono", "", "", {0.0, 1.0, 0.0, 1.0}, 0.0, 0.0f, enableTextFunction);
     glideMode = p.addIntParam("gMode", "Glide Mode", "Glizz", "", {0.0, 2.0, 0.0, 1.0}, 0.0f, 0.0f, glideModeTextFunction);
     glideRate = p.addExtParam("gRate", "Glide Rate", "Rate", " s", {0.001f, 20.0, 0.0, 0.2f}, 0.3f, 0.0f);
@@ -575,6 +630,13 @@ void PMProcessor::GlobalParams::setup(PMProcessor &p)
     mpe = p.addIntParam("mpe", "MPE", "", "", {0.0, 1.0, 1.0, 1.0}, 0.0f, 0.0f, enableTextFunction);
     pitchbendRange = p.addIntParam("pbrange", "PB Range", "", "", {0.0, 96.0, 1.0, 1.0}, 2.0, 0.05f);
     modfm = p.addExtParam("modfm", "FM Type", "", "", {0.0, 1.0, 1.0, 1.0}, 1.0f, 0.0f, fmTypeTextFunction);
+    oversampling = p.addIntParam("oversampling", "Oversampling", "", "", {0.0, 4.0, 1.0, 1.0}, 3.0f, 0.0f, oversamplingTextFunction);
+    decimation = p.addIntParam("decimation", "Downsampling", "", "", {0.0, 1.0, 1.0, 1.0}, 0.0f, 0.0f, decimationTextFunction);
+    polyphony = p.addIntParam("polyphony", "Polyphony", "", "", {1.0, float(VoiceBank::maxVoices), 1.0, 1.0}, 8.0f, 0.0f);
+    controlRate = p.addIntParam("ctlrate", "Mod Resolution", "", "", {0.0, 3.0, 1.0, 1.0}, 2.0f, 0.0f, controlRateTextFunction);
+    multicore = p.addIntParam("multicore", "Multi-core", "", "", {0.0, 1.0, 1.0, 1.0}, 0.0f, 0.0f, enableTextFunction);
+    synthBlock = p.addIntParam("synthblock", "Synth Block", "", "", {0.0, 3.0, 1.0, 1.0}, 1.0f, 0.0f, synthBlockTextFunction);
+    fxBlock = p.addIntParam("fxblock", "FX Block", "", "", {0.0, 3.0, 1.0, 1.0}, 0.0f, 0.0f, fxBlockTextFunction);
 
     modTone->conversionFunction = [](float in) { return juce::NormalisableRange<float>(0.0, 1.0, 0.0, 0.5).convertFrom0to1(in); };
     modIndex->conversionFunction = [](float in) { return in * 0.166667f; };
@@ -711,6 +773,7 @@ void PMProcessor::RingModParams::setup(PMProcessor &p)
     spread = p.addExtParam(pfx + "spread", name + "Spread", "Spread", "", {0.0, 1.0, 0.0, 1.0}, 0.03f, 0.05f, percentTextFunction);
     lowcut = p.addExtParam(pfx + "lowcut", name + "Low Cut", "Low Cut", " Hz", {20.0, 20000.0, 0.0, 0.3f}, 20.0f, 0.05f);
     highcut = p.addExtParam(pfx + "highcut", name + "High Cut", "High Cut", " Hz", {20.0, 20000.0, 0.0, 0.3f}, 20000.0f, 0.05f);
+    oversampling = p.addIntParam(pfx + "os", name + "Oversampling", "Oversampling", "", {0.0, 1.0, 1.0, 1.0}, 0.0f, 0.0f, rmOversamplingTextFunction);
 }
 
 //==============================================================================
@@ -720,6 +783,16 @@ static juce::String fxRouteFunction(const gin::Parameter &, float v) { return v
 
 static juce::String fxPrePostFunction(const gin::Parameter &, float v) { return v < 0.5f ? "Pre" : "Post"; }
 
+static juce::String macroControllerTextFunction(const gin::Parameter &, float v)
+{
+    const int controller = static_cast<int>(v);
+    if (controller < 0)
+        return "None";
+    if (controller >= MidiDispatch::nrpnBase)
+        return "NRPN " + juce::String(controller - MidiDispatch::nrpnBase);
+    return "CC " + juce::String(controller);
+}
+
 //==============================================================================
 void PMProcessor::FXOrderParams::setup(PMProcessor &p)
 {
@@ -754,9 +827,11 @@ void PMProcessor::MacroParams::setup(PMProcessor &p)
     macro2 = p.addExtParam(name + "2", name + "2", name + "2", "", {0.0, 1.0, 0.0, 1.0}, 0.0f, 0.0f, percentTextFunction);
     macro3 = p.addExtParam(name + "3", name + "3", name + "3", "", {0.0, 1.0, 0.0, 1.0}, 0.0f, 0.0f, percentTextFunction);
     learning = p.addIntParam("Learn", "Learn", "Learn", "", {0.0, 4.0, 1.0, 1.0}, 0.0f, 0.0f);
-    macro1cc = p.addIntParam("Macro1CC", "Macro 1 CC", "CC", "", {-1.0, 127.0, 1.0, 1.0}, -1.0f, 0.0f);
-    macro2cc = p.addIntParam("Macro2CC", "Macro 2 CC", "CC", "", {-1.0, 127.0, 1.0, 1.0}, -1.0f, 0.0f);
-    macro3cc = p.addIntParam("Macro3CC", "Macro 3 CC", "CC", "", {-1.0, 127.0, 1.0, 1.0}, -1.0f, 0.0f);
+    // a CC number, or MidiDispatch::nrpnBase + an NRPN number
+    const juce::NormalisableRange<float> controllers{-1.0f, float(MidiDispatch::nrpnBase + MidiDispatch::numNrpns - 1), 1.0f, 1.0f};
+    macro1cc = p.addIntParam("Macro1CC", "Macro 1 CC", "CC", "", controllers, -1.0f, 0.0f, macroControllerTextFunction);
+    macro2cc = p.addIntParam("Macro2CC", "Macro 2 CC", "CC", "", controllers, -1.0f, 0.0f, macroControllerTextFunction);
+    macro3cc = p.addIntParam("Macro3CC", "Macro 3 CC", "CC", "", controllers, -1.0f, 0.0f, macroControllerTextFunction);
 }
 
 bool PMProcessor::isBusesLayoutSupported(const BusesLayout &layouts) const
@@ -791,14 +866,7 @@ PMProcessor::PMProcessor()
     }
     convex[0] = 0.0;
     convex[1023] = 1.0;
-
-    hiir::PolyphaseIir2Designer::compute_coefs_spec_order_tbw(coefs1, nbr_coefs1, .28);
-    hiir::PolyphaseIir2Designer::compute_coefs_spec_order_tbw(coefs2, nbr_coefs2, .03);
-
-    dspl1L.set_coefs(coefs1); // 2x down with wide tb
-    dspl1R.set_coefs(coefs1); // 2x down with wide tb
-    dspl2L.set_coefs(coefs2); // 2x down with narrow tb
-    dspl2R.set_coefs(coefs2); // 2x down with narrow tb
+    std::transform(convex.begin(), convex.end(), convexF.begin(), [](const double v) { return static_cast<float>(v); });
 
     osc1Params.setup(*this, juce::String{"1"});
     osc2Params.setup(*this, juce::String{"2"});
@@ -826,6 +894,7 @@ PMProcessor::PMProcessor()
     // mono params begin in the middle of this block
     globalParams.setup(*this);
 
+    const int firstEffectParam = getPluginParameters().size();
     gainParams.setup(*this);
     waveshaperParams.setup(*this);
     compressorParams.setup(*this);
@@ -839,6 +908,11 @@ PMProcessor::PMProcessor()
 
     fxOrderParams.setup(*this);
 
+    const auto params = getPluginParameters();
+    for (int i = firstEffectParam; i < params.size(); i++)
+        effectParams.push_back(params[i]);
+    effectParams.push_back(globalParams.level);
+
     mseg1Data.reset();
     mseg2Data.reset();
     mseg3Data.reset();
@@ -855,12 +929,26 @@ PMProcessor::PMProcessor()
     setupModMatrix();
     init();
 
-    modMatrix.setMonoValue(randSrc1Mono, 0.0f);
-    modMatrix.setMonoValue(randSrc2Mono, 0.0f);
+    routing.setMonoValue(randSrc1Mono, 0.0f);
+    routing.setMonoValue(randSrc2Mono, 0.0f);
+
+    globalParams.oversampling->addListener(this);
+    globalParams.decimation->addListener(this);
+    globalParams.multicore->addListener(this);
+
+    const auto &fx = fxOrderParams;
+    layoutParams = {fx.fxa1, fx.fxa2, fx.fxa3, fx.fxa4, fx.fxb1, fx.fxb2, fx.fxb3, fx.fxb4, fx.chainAtoB, ringmodParams.oversampling};
+    for (auto *p : layoutParams)
+        p->addListener(this);
 }
 
 PMProcessor::~PMProcessor()
 {
+    globalParams.oversampling->removeListener(this);
+    globalParams.decimation->removeListener(this);
+    globalParams.multicore->removeListener(this);
+    for (auto *p : layoutParams)
+        p->removeListener(this);
     juce::LookAndFeel::setDefaultLookAndFeel(nullptr);
     MTS_DeregisterClient(client);
 }
@@ -909,16 +997,23 @@ void PMProcessor::setupModMatrix()
 
     const auto firstMonoParam = globalParams.mono;
     bool polyParam = true;
+    std::vector<gin::Parameter *> polyParams;
     for (const auto pp : getPluginParameters())
     {
         if (pp == firstMonoParam)
             polyParam = false;
 
         if (!pp->isInternal())
+        {
             modMatrix.addParameter(pp, polyParam);
+            if (polyParam)
+                polyParams.push_back(pp);
+        }
     }
 
     modMatrix.build();
+    snapshot.setup(getPluginParameters());
+    routing.setup(polyParams);
 }
 
 void PMProcessor::stateUpdated() // called when loading a preset
@@ -991,6 +1086,12 @@ void PMProcessor::reset()
 
     waveshaper.reset();
     compressor.reset();
+    for (auto &section : laneASections)
+        section.reset();
+    for (auto &section : laneBSections)
+        section.reset();
+    for (auto &delay : laneDelays)
+        delay.reset();
 }
 
 void PMProcessor::prepareToPlay(double newSampleRate, int newSamplesPerBlock)
@@ -998,11 +1099,23 @@ void PMProcessor::prepareToPlay(double newSampleRate, int newSamplesPerBlock)
     Processor::prepareToPlay(newSampleRate, newSamplesPerBlock);
     const juce::dsp::ProcessSpec spec{newSampleRate, static_cast<juce::uint32>(newSamplesPerBlock), 2};
 
-    upsampledTables.setSampleRate(newSampleRate * 4);
     analogTables.setSampleRate(newSampleRate);
-
-    synth.setCurrentPlaybackSampleRate(newSampleRate * 4);
+    upsampled2xTables.setSampleRate(newSampleRate * 2);
+    upsampledTables.setSampleRate(newSampleRate * 4);
+    upsampled8xTables.setSampleRate(newSampleRate * 8);
+    modfmTables.build();
+
+    decimator.prepare(newSampleRate);
+    const int choice = globalParams.oversampling->getUserValueInt();
+    decimationMode = globalParams.decimation->getUserValueInt() == 1 ? Decimator::Mode::fir : Decimator::Mode::iir;
+    oversampling = 0; // so setOversampling() sets the synth up for the new rate
+    setOversampling(choice == 0 ? 4 : 1 << (choice - 1));
+    synth.setMaxBlockSize(maxSynthBlockSize * 8);
+    synth.setMultiThreaded(globalParams.multicore->isOn());
+    maxBlockSize = newSamplesPerBlock;
+    laneBBuffer.setSize(2, newSamplesPerBlock);
     modMatrix.setSampleRate(newSampleRate);
+    snapshot.setSampleRate(newSampleRate);
 
     stereoDelay.prepare(spec);
     effectGain.prepare(spec);
@@ -1013,6 +1126,20 @@ void PMProcessor::prepareToPlay(double newSampleRate, int newSamplesPerBlock)
     reverb.prepare(spec);
     mbfilter.prepare(spec);
     ringmod.prepare(spec);
+    for (auto &section : laneASections)
+        section.prepare(spec);
+    for (auto &section : laneBSections)
+        section.prepare(spec);
+
+    // a pad is at most one lane's two FIR trips to 2x and back
+    for (auto &delay : laneDelays)
+    {
+        delay.prepare(spec);
+        delay.setMaximumDelayInSamples(static_cast<int>(2.0 * laneASections[0].getLatency(OversampledSection::Filter::fir)) + 2);
+    }
+    lanePads = {};
+    updateEffectsLatency();
+
     ladder.prepare(spec);
     limiter.prepare(spec);
     limiter.setRelease(0.1f);
@@ -1033,36 +1160,137 @@ void PMProcessor::prepareToPlay(double newSampleRate, int newSamplesPerBlock)
 
 void PMProcessor::releaseResources() {}
 
-void PMProcessor::downsampleStage1(const juce::dsp::AudioBlock<float> &inputBlock, juce::dsp::AudioBlock<float> &outputBlock)
+gin::BandLimitedLookupTables &PMProcessor::tablesForOversampling(const int factor)
+{
+    switch (factor)
+    {
+    case 1:
+        return analogTables;
+    case 2:
+        return upsampled2xTables;
+    case 8:
+        return upsampled8xTables;
+    default:
+        return upsampledTables;
+    }
+}
+
+// Returns the lowest factor at which the highest FM sideband (by Carson's rule) of the highest note starting in 'midi'
+// folds back above 20 kHz, where the decimator removes it, or 0 if no note starts.
+int PMProcessor::autoOversamplingFactor(const juce::MidiBuffer &midi) const
+{
+    float noteFreq = 0.f;
+    for (const auto metadata : midi)
+    {
+        if (const auto msg = metadata.getMessage(); msg.isNoteOn())
+            noteFreq = std::max(noteFreq, tuning.frequency(msg.getNoteNumber(), msg.getChannel()));
+    }
+    if (noteFreq <= 0.f)
+        return 0;
+    noteFreq = juce::jlimit(20.0f, 20000.f, noteFreq * timbreParams.pitch->getUserValue());
+
+    float maxFreq = 0.f;
+    for (const auto *osc : {&osc1Params, &osc2Params, &osc3Params, &osc4Params})
+    {
+        if (osc->volume->getUserValue() < -49.5f)
+            continue;
+        const float ratio = static_cast<float>(osc->coarse->getUserValueInt()) + osc->fine->getUserValue();
+        maxFreq = std::max(maxFreq, osc->fixed->isOn() ? ratio * 100.f : ratio * noteFreq);
+    }
+
+    const auto &modIndex = globalParams.modIndex;
+    const float beta = juce::MathConstants<float>::twoPi * modIndex->conversionFunction(modIndex->getUserValue());
+    const float highest = maxFreq * (beta + 2.f);
+    const auto sr = static_cast<float>(getSampleRate());
+
+    for (const int factor : {1, 2, 4})
+        if (highest < sr * static_cast<float>(factor) - 20000.f)
+            return factor;
+    return 8;
+}
+
+// changing the synth's rate stops its voices, so this only runs from prepareToPlay(), from the message
+// thread with processing suspended, or from the audio thread when no voice is playing
+void PMProcessor::setOversampling(const int factor)
+{
+    if (factor != oversampling)
+    {
+        oversampling = factor;
+        synth.setTables(tablesForOversampling(oversampling));
+        synth.setCurrentPlaybackSampleRate(getSampleRate() * oversampling);
+    }
+
+    decimator.setup(oversampling, decimationMode);
+}
+
+// audio thread: in auto mode the factor follows the notes being started, and only changes between notes
+void PMProcessor::updateAutoOversampling(const juce::MidiBuffer &midi)
+{
+    if (synth.isAnyVoiceActive())
+        return;
+    if (const int factor = autoOversamplingFactor(midi); factor != 0 && factor != oversampling)
+        setOversampling(factor);
+}
+
+// message thread: settings that can't change in the middle of a block
+void PMProcessor::valueUpdated(gin::Parameter *p)
 {
-    const auto inSamplesL = inputBlock.getChannelPointer(0);
-    const auto inSamplesR = inputBlock.getChannelPointer(1);
-    const auto outSamplesL = outputBlock.getChannelPointer(0);
-    const auto outSamplesR = outputBlock.getChannelPointer(1);
+    if (getSampleRate() <= 0.0) // not prepared yet; prepareToPlay() will pick the settings up
+        return;
+
+    if (p == globalParams.oversampling || p == globalParams.decimation)
+    {
+        const int choice = globalParams.oversampling->getUserValueInt();
+        const int factor = choice == 0 ? oversampling : 1 << (choice - 1);
+        const auto mode = globalParams.decimation->getUserValueInt() == 1 ? Decimator::Mode::fir : Decimator::Mode::iir;
+        if (factor == oversampling && mode == decimationMode)
+            return;
+
+        suspendProcessing(true);
+        decimationMode = mode;
+        setOversampling(factor);
+        suspendProcessing(false);
+        updateLatency();
+    }
+    else if (std::find(layoutParams.begin(), layoutParams.end(), p) != layoutParams.end())
+    {
+        updateEffectsLatency();
+    }
+    else if (p == globalParams.multicore)
+    {
+        // the worker threads are started and stopped while no block is being rendered
+        suspendProcessing(true);
+        synth.setMultiThreaded(globalParams.multicore->isOn());
+        suspendProcessing(false);
+    }
+}
 
-    const int samples = static_cast<int>(outputBlock.getNumSamples());
-    dspl1L.process_block(outSamplesL, inSamplesL, samples);
-    dspl1R.process_block(outSamplesR, inSamplesR, samples);
+// prepareToPlay() or message thread: the effects' latency for the lane layout the parameters hold now
+void PMProcessor::updateEffectsLatency()
+{
+    const auto &fx = fxOrderParams;
+    const std::array<int, 4> laneA{fx.fxa1->getUserValueInt(), fx.fxa2->getUserValueInt(), fx.fxa3->getUserValueInt(), fx.fxa4->getUserValueInt()};
+    const std::array<int, 4> laneB{fx.fxb1->getUserValueInt(), fx.fxb2->getUserValueInt(), fx.fxb3->getUserValueInt(), fx.fxb4->getUserValueInt()};
+    effectsLatency = effectsLatencyFor(laneA, laneB, fx.chainAtoB->isOn()).total;
+    updateLatency();
 }
-void PMProcessor::downsampleStage2(const juce::dsp::AudioBlock<float> &inputBlock, juce::dsp::AudioBlock<float> &outputBlock)
+
+// prepareToPlay() or message thread: the decimator's latency is fixed per mode, so the factor Auto picks doesn't change it
+void PMProcessor::updateLatency()
 {
-    const auto inSamplesL = inputBlock.getChannelPointer(0);
-    const auto inSamplesR = inputBlock.getChannelPointer(1);
-    const auto outSamplesL = outputBlock.getChannelPointer(0);
-    const auto outSamplesR = outputBlock.getChannelPointer(1);
-    const int samples = static_cast<int>(outputBlock.getNumSamples());
-    dspl2L.process_block(outSamplesL, inSamplesL, samples);
-    dspl2R.process_block(outSamplesR, inSamplesR, samples);
+    const int latency = decimator.getLatencySamples() + effectsLatency;
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
 }
 
 void PMProcessor::processBlock(juce::AudioBuffer<float> &buffer, juce::MidiBuffer &midi)
 {
     juce::ScopedNoDenormals noDenormals;
+    snapshot.update(modMatrix);
 
     const auto numSamples = buffer.getNumSamples();
 
-    if (MTS_HasMaster(client))
-        scaleName = MTS_GetScaleName(client);
+    tuning.update(client);
 
     if (modMatrix.getLearn().id != -1)
         learning = "Learning: " + modMatrix.getModSrcName(modMatrix.getLearn());
@@ -1079,7 +1307,7 @@ void PMProcessor::processBlock(juce::AudioBuffer<float> &buffer, juce::MidiBuffe
 
     synth.startBlock();
     synth.setMPE(globalParams.mpe->isOn());
-    playhead = getPlayHead();
+    transport.update(getPlayHead());
     int pos = 0;
     int todo = numSamples;
 
@@ -1090,48 +1318,62 @@ void PMProcessor::processBlock(juce::AudioBuffer<float> &buffer, juce::MidiBuffe
     synth.setGlissando(globalParams.glideMode->getUserValue() == 1.0f);
     synth.setPortamento(globalParams.glideMode->getUserValue() == 2.0f);
     synth.setGlideRate(globalParams.glideRate->getUserValue());
-    synth.setNumVoices(numVoices);
+    synth.setNumVoices(globalParams.polyphony->getUserValueInt());
+    synth.dispatch.updateRouting();
+    if (globalParams.oversampling->getUserValueInt() == 0)
+        updateAutoOversampling(midi);
+    const int factor = oversampling;
+
+    if (factor > 1)
+    {
+        osSynthBuffer.setSize(2, numSamples * factor, false, false, true);
+        osSynthBuffer.clear();
+    }
 
-    synthBuffer.setSize(2, numSamples * 2, false, false, true);
-    synthBuffer.clear();
-    preSynthBuffer.setSize(2, numSamples * 4, false, false, true);
-    preSynthBuffer.clear();
+    const int synthStep = getSynthBlockSize();
+    const int fxStep = std::min(effectsModulated() ? getFxBlockSize() : numSamples, maxBlockSize);
+    int fxPos = 0;
 
     while (todo > 0)
     {
-        const int thisBlock = std::min(todo, MINI_BLOCK_SIZE);
+        const int thisBlock = std::min(todo, synthStep);
         updateParams(thisBlock);
 
-        synth.renderNextBlock(preSynthBuffer, midi, pos * 4, thisBlock * 4);
-        auto preSynthBufferSlice = gin::sliceBuffer(preSynthBuffer, pos * 4, thisBlock * 4);
-        auto preSynthBufferSliceBlock = juce::dsp::AudioBlock<float>(preSynthBufferSlice);
-
-        auto synthBufferSlice = gin::sliceBuffer(synthBuffer, pos * 2, thisBlock * 2);
-        auto synthBufferSliceBlock = juce::dsp::AudioBlock<float>(synthBufferSlice);
-
-        auto bufferSlice = gin::sliceBuffer(buffer, pos, thisBlock);
-        auto bufferSliceBlock = juce::dsp::AudioBlock<float>(bufferSlice);
-
-        downsampleStage1(preSynthBufferSliceBlock, synthBufferSliceBlock);
-        downsampleStage2(synthBufferSliceBlock, bufferSliceBlock);
+        if (factor == 1)
+            synth.renderNextBlock(buffer, midi, pos, thisBlock);
+        else
+            synth.renderNextBlock(osSynthBuffer, midi, pos * factor, thisBlock * factor);
+        pos += thisBlock;
+        todo -= thisBlock;
 
-        applyEffects(bufferSlice);
+        // once a whole effects block has been rendered, or the last of the buffer, bring it down to the host rate and run the effects
+        while (fxPos < pos && (pos - fxPos >= fxStep || todo == 0))
+        {
+            const int fxBlock = std::min(fxStep, pos - fxPos);
+            // at 1x the synth rendered straight into 'buffer', and the decimator only delays it to the mode's latency
+            auto &synthOut = factor > 1 ? osSynthBuffer : buffer;
+            decimator.process(buffer.getWritePointer(0, fxPos), buffer.getWritePointer(1, fxPos), synthOut.getReadPointer(0, fxPos * factor),
+                              synthOut.getReadPointer(1, fxPos * factor), fxBlock);
+
+            updateEffectParams();
+            auto bufferSlice = gin::sliceBuffer(buffer, fxPos, fxBlock);
+            applyEffects(bufferSlice);
+            fxPos += fxBlock;
+        }
 
         modMatrix.finishBlock(thisBlock);
-        pos += thisBlock;
-        todo -= thisBlock;
+        snapshot.advance(thisBlock);
     }
 
-    playhead = nullptr;
     levelTracker.trackBuffer(buffer);
-    synth.endBlock(numSamples * 4);
+    synth.endBlock(numSamples * factor);
 }
 
 juce::Array<float> PMProcessor::getLiveFilterCutoff() const { return synth.getLiveFilterCutoff(); }
 
 void PMProcessor::applyEffects(juce::AudioSampleBuffer &fxALaneBuffer)
 {
-    // knowing which effects are active is now handled in updateParams()
+    // knowing which effects are active is now handled in updateEffectParams()
 
     const int numSamples = fxALaneBuffer.getNumSamples();
     const float laneAQ = gin::Q / (1.0f - (modMatrix.getValue(fxOrderParams.laneARes) / 100.0f) * 0.99f);
@@ -1226,9 +1468,6 @@ void PMProcessor::applyEffects(juce::AudioSampleBuffer &fxALaneBuffer)
     // case 1: lane A feeds into lane B
     if (fxOrderParams.chainAtoB->isOn())
     {
-        auto outBlock = juce::dsp::AudioBlock<float>(fxALaneBuffer);
-        const auto outContext = juce::dsp::ProcessContextReplacing<float>(outBlock);
-
         if (laneAPre)
         {
             laneAFilter.process(fxALaneBuffer);
@@ -1237,46 +1476,7 @@ void PMProcessor::applyEffects(juce::AudioSampleBuffer &fxALaneBuffer)
             fxALaneBuffer.applyGain(1, 0, numSamples, gain * std::min(1 + laneAPan, 1.0f));
         }
 
-        for (const int fx : {fxa1, fxa2, fxa3, fxa4})
-        {
-            switch (fx)
-            {
-            case 0:
-                break;
-            case 1:
-                waveshaper.process(outContext);
-                break;
-            case 2:
-                compressor.process(fxALaneBuffer);
-                break;
-            case 3:
-                stereoDelay.process(outContext);
-                break;
-            case 4:
-                chorus.process(outContext);
-                break;
-            case 5:
-                mbfilter.process(outContext);
-                break;
-            case 6:
-                reverb.process(outContext);
-                break;
-            case 7:
-                ringmod.process(outContext);
-                break;
-            case 8:
-                effectGain.process(outContext);
-                break;
-            case 9:
-                ladder.process(outContext);
-                break;
-            case 10:
-                stereo.process(fxALaneBuffer);
-                break;
-            default:
-                break;
-            }
-        }
+        processLane({fxa1, fxa2, fxa3, fxa4}, fxALaneBuffer, laneASections);
 
         if (!laneAPre)
         {
@@ -1294,46 +1494,8 @@ void PMProcessor::applyEffects(juce::AudioSampleBuffer &fxALaneBuffer)
             fxALaneBuffer.applyGain(1, 0, numSamples, gain * std::min(1 + laneBPan, 1.0f));
         }
 
-        for (const int fx : {fxb1, fxb2, fxb3, fxb4})
-        {
-            switch (fx)
-            {
-            case 0:
-                break;
-            case 1:
-                waveshaper.process(outContext);
-                break;
-            case 2:
-                compressor.process(fxALaneBuffer);
-                break;
-            case 3:
-                stereoDelay.process(outContext);
-                break;
-            case 4:
-                chorus.process(outContext);
-                break;
-            case 5:
-                mbfilter.process(outContext);
-                break;
-            case 6:
-                reverb.process(outContext);
-                break;
-            case 7:
-                ringmod.process(outContext);
-                break;
-            case 8:
-                effectGain.process(outContext);
-                break;
-            case 9:
-                ladder.process(outContext);
-                break;
-            case 10:
-                stereo.process(fxALaneBuffer);
-                break;
-            default:
-                break;
-            }
-        }
+        processLane({fxb1, fxb2, fxb3, fxb4}, fxALaneBuffer, laneBSections);
+        padLane(0, fxALaneBuffer);
 
         if (!laneBPre)
         {
@@ -1346,8 +1508,10 @@ void PMProcessor::applyEffects(juce::AudioSampleBuffer &fxALaneBuffer)
     // case 2: lanes A and B are run in parallel
     else
     {
-        juce::AudioBuffer<float> fxBLaneBuffer;
-        fxBLaneBuffer.makeCopyOf(fxALaneBuffer);
+        auto &fxBLaneBuffer = laneBBuffer;
+        fxBLaneBuffer.setSize(2, numSamples, false, false, true);
+        fxBLaneBuffer.copyFrom(0, 0, fxALaneBuffer, 0, 0, numSamples);
+        fxBLaneBuffer.copyFrom(1, 0, fxALaneBuffer, 1, 0, numSamples);
 
         if (laneAPre)
         {
@@ -1365,90 +1529,11 @@ void PMProcessor::applyEffects(juce::AudioSampleBuffer &fxALaneBuffer)
             fxBLaneBuffer.applyGain(1, 0, numSamples, gain * 0.5f * std::min(1 + laneBPan, 1.0f));
         }
 
-        auto ABlock = juce::dsp::AudioBlock<float>(fxALaneBuffer);
-        const auto AContext = juce::dsp::ProcessContextReplacing<float>(ABlock);
-        auto BBlock = juce::dsp::AudioBlock<float>(fxBLaneBuffer);
-        const auto BContext = juce::dsp::ProcessContextReplacing<float>(BBlock);
-        for (const int fx : {fxa1, fxa2, fxa3, fxa4})
-        {
-            switch (fx)
-            {
-            case 0:
-                break;
-            case 1:
-                waveshaper.process(AContext);
-                break;
-            case 2:
-                compressor.process(fxALaneBuffer);
-                break;
-            case 3:
-                stereoDelay.process(AContext);
-                break;
-            case 4:
-                chorus.process(AContext);
-                break;
-            case 5:
-                mbfilter.process(AContext);
-                break;
-            case 6:
-                reverb.process(AContext);
-                break;
-            case 7:
-                ringmod.process(AContext);
-                break;
-            case 8:
-                effectGain.process(AContext);
-                break;
-            case 9:
-                ladder.process(AContext);
-                break;
-            case 10:
-                stereo.process(fxALaneBuffer);
-                break;
-            default:
-                break;
-            }
-        }
-        for (const int fx : {fxb1, fxb2, fxb3, fxb4})
-        {
-            switch (fx)
-            {
-            case 0:
-                break;
-            case 1:
-                waveshaper.process(BContext);
-                break;
-            case 2:
-                compressor.process(fxBLaneBuffer);
-                break;
-            case 3:
-                stereoDelay.process(BContext);
-                break;
-            case 4:
-                chorus.process(BContext);
-                break;
-            case 5:
-                mbfilter.process(BContext);
-                break;
-            case 6:
-                reverb.process(BContext);
-                break;
-            case 7:
-                ringmod.process(BContext);
-                break;
-            case 8:
-                effectGain.process(BContext);
-                break;
-            case 9:
-                ladder.process(BContext);
-                break;
-            case 10:
-                stereo.process(fxBLaneBuffer);
-                break;
-            default:
-                break;
-            }
-        }
+        // each lane is padded out to the same whole number of samples, so they line up when they're mixed
+        processLane({fxa1, fxa2, fxa3, fxa4}, fxALaneBuffer, laneASections);
+        padLane(0, fxALaneBuffer);
+        processLane({fxb1, fxb2, fxb3, fxb4}, fxBLaneBuffer, laneBSections);
+        padLane(1, fxBLaneBuffer);
 
         if (!laneAPre)
         {
@@ -1477,6 +1562,152 @@ void PMProcessor::applyEffects(juce::AudioSampleBuffer &fxALaneBuffer)
     limiter.process(AContext);
 }
 
+// whether anything the effects read is modulated, was changed this buffer or is still easing towards a change,
+// in which case they have to follow it block by block
+bool PMProcessor::effectsModulated() const
+{
+    const auto &changed = snapshot.getChanged();
+    const bool moving = std::any_of(effectParams.begin(), effectParams.end(), [this, &changed](const gin::Parameter *p) {
+        if (p->getModIndex() >= 0 && (snapshot.isModulated(p) || snapshot.isRamping(p)))
+            return true;
+        return std::find(changed.begin(), changed.end(), p) != changed.end();
+    });
+    return moving || (activeEffects.contains(1) && waveshaper.isSmoothing()) || laneAFilterCutoff.isSmoothing() ||
+           laneBFilterCutoff.isSmoothing();
+}
+
+// the waveshaper and the ring modulator run at twice the host rate
+static bool isOversampledEffect(const int fx) { return fx == 1 || fx == 7; }
+
+// neighbouring oversampled effects, with any empty slots between them, share one trip to 2x and back;
+// this is where the run starting at slots[i] ends
+static size_t oversampledRunEnd(const std::array<int, 4> &slots, const size_t i)
+{
+    size_t end = i + 1;
+    while (end < slots.size() && (slots[end] == 0 || isOversampledEffect(slots[end])))
+        end++;
+    return end;
+}
+
+// a run with the ring modulator in it uses the filter picked for it; others use the IIR
+static OversampledSection::Filter runFilter(const std::array<int, 4> &slots, const size_t i, const size_t end, const bool ringmodIir)
+{
+    const bool hasRingmod = std::find(slots.begin() + long(i), slots.begin() + long(end), 7) != slots.begin() + long(end);
+    return hasRingmod && !ringmodIir ? OversampledSection::Filter::fir : OversampledSection::Filter::iir;
+}
+
+// in host samples: only the trips to 2x and back delay the signal
+double PMProcessor::laneLatency(const std::array<int, 4> &slots) const
+{
+    const bool ringmodIir = ringmodParams.oversampling->getUserValueInt() == 1;
+    double latency = 0.0;
+    size_t i = 0;
+    while (i < slots.size())
+    {
+        if (!isOversampledEffect(slots[i]))
+        {
+            i++;
+            continue;
+        }
+        const size_t end = oversampledRunEnd(slots, i);
+        latency += laneASections[0].getLatency(runFilter(slots, i, end, ringmodIir)); // every section has the same two filters
+        i = end;
+    }
+    return latency;
+}
+
+// the host is told the total, so the fraction left by the IIR half-bands is padded out rather than rounded away
+PMProcessor::EffectsLatency PMProcessor::effectsLatencyFor(const std::array<int, 4> &laneA, const std::array<int, 4> &laneB, const bool chain) const
+{
+    const double a = laneLatency(laneA);
+    const double b = laneLatency(laneB);
+
+    EffectsLatency l;
+    if (chain)
+    {
+        l.total = static_cast<int>(std::ceil(a + b - 0.0001));
+        l.padA = std::max(0.0, l.total - (a + b));
+    }
+    else
+    {
+        l.total = static_cast<int>(std::ceil(std::max(a, b) - 0.0001));
+        l.padA = std::max(0.0, l.total - a);
+        l.padB = std::max(0.0, l.total - b);
+    }
+    return l;
+}
+
+// lane 0 or 1's fractional pad, from lanePads; in chain mode lane 0's pad follows lane B
+void PMProcessor::padLane(const size_t lane, juce::AudioSampleBuffer &buffer)
+{
+    if ((lane == 0 ? lanePads.padA : lanePads.padB) < 0.0001)
+        return;
+
+    auto block = juce::dsp::AudioBlock<float>(buffer);
+    laneDelays[lane].process(juce::dsp::ProcessContextReplacing<float>(block));
+}
+
+void PMProcessor::processLane(const std::array<int, 4> &slots, juce::AudioSampleBuffer &buffer, std::array<OversampledSection, 2> &sections)
+{
+    auto block = juce::dsp::AudioBlock<float>(buffer);
+    const auto context = juce::dsp::ProcessContextReplacing<float>(block);
+    const bool ringmodIir = ringmodParams.oversampling->getUserValueInt() == 1;
+    size_t run = 0;
+
+    size_t i = 0;
+    while (i < slots.size())
+    {
+        if (isOversampledEffect(slots[i]))
+        {
+            const size_t end = oversampledRunEnd(slots, i);
+            auto &section = sections[run++];
+            section.setFilter(runFilter(slots, i, end, ringmodIir));
+            auto upBlock = section.up(block);
+            const auto upContext = juce::dsp::ProcessContextReplacing<float>(upBlock);
+            for (; i < end; i++)
+            {
+                if (slots[i] == 1)
+                    waveshaper.process(upContext);
+                else if (slots[i] == 7)
+                    ringmod.process(upContext);
+            }
+            section.down(block);
+            continue;
+        }
+
+        switch (slots[i])
+        {
+        case 2:
+            compressor.process(buffer);
+            break;
+        case 3:
+            stereoDelay.process(context);
+            break;
+        case 4:
+            chorus.process(context);
+            break;
+        case 5:
+            mbfilter.process(context);
+            break;
+        case 6:
+            reverb.process(context);
+            break;
+        case 8:
+            effectGain.process(context);
+            break;
+        case 9:
+            ladder.process(context);
+            break;
+        case 10:
+            stereo.process(buffer);
+            break;
+        default:
+            break;
+        }
+        i++;
+    }
+}
+
 gin::ProcessorOptions PMProcessor::getOptions() const
 {
     gin::ProcessorOptions options;
@@ -1491,26 +1722,6 @@ gin::ProcessorOptions PMProcessor::getOptions() const
 
 void PMProcessor::updateParams(int newBlockSize)
 {
-    // Check which effects are active
-    fxa1 = fxOrderParams.fxa1->getUserValueInt();
-    fxa2 = fxOrderParams.fxa2->getUserValueInt();
-    fxa3 = fxOrderParams.fxa3->getUserValueInt();
-    fxa4 = fxOrderParams.fxa4->getUserValueInt();
-    fxb1 = fxOrderParams.fxb1->getUserValueInt();
-    fxb2 = fxOrderParams.fxb2->getUserValueInt();
-    fxb3 = fxOrderParams.fxb3->getUserValueInt();
-    fxb4 = fxOrderParams.fxb4->getUserValueInt();
-
-    activeEffects.clear();
-    activeEffects.insert(fxa1);
-    activeEffects.insert(fxa2);
-    activeEffects.insert(fxa3);
-    activeEffects.insert(fxa4);
-    activeEffects.insert(fxb1);
-    activeEffects.insert(fxb2);
-    activeEffects.insert(fxb3);
-    activeEffects.insert(fxb4);
-
     // Update Mono LFOs
     for (const auto lfoparams : {&lfo1Params, &lfo2Params, &lfo3Params, &lfo4Params})
     {
@@ -1519,7 +1730,7 @@ void PMProcessor::updateParams(int newBlockSize)
         float freq = 0;
         if (lfoparams->sync->getUserValue() > 0.0f)
         {
-            freq = 1.0f / gin::NoteDuration::getNoteDurations()[static_cast<size_t>(lfoparams->beat->getUserValue())].toSeconds(playhead);
+            freq = transport.noteRate(lfoparams->beat->getUserValue());
         }
         else
         {
@@ -1537,12 +1748,57 @@ void PMProcessor::updateParams(int newBlockSize)
         lfo->setParameters(classparams);
         lfo->process(newBlockSize);
 
-        modMatrix.setMonoValue(*(this->monoLfoIds[static_cast<size_t>(lfoparams->num - 1)]), lfo->getOutput());
+        routing.setMonoValue(*(this->monoLfoIds[static_cast<size_t>(lfoparams->num - 1)]), lfo->getOutput());
+    }
+
+    routing.setMonoValue(macroSrc1, modMatrix.getValue(macroParams.macro1));
+    routing.setMonoValue(macroSrc2, modMatrix.getValue(macroParams.macro2));
+    routing.setMonoValue(macroSrc3, modMatrix.getValue(macroParams.macro3));
+}
+
+// only the effects in a lane are set up
+void PMProcessor::updateEffectParams()
+{
+    // Check which effects are active
+    const std::array<int, 4> laneA{fxa1, fxa2, fxa3, fxa4}, laneB{fxb1, fxb2, fxb3, fxb4};
+    fxa1 = fxOrderParams.fxa1->getUserValueInt();
+    fxa2 = fxOrderParams.fxa2->getUserValueInt();
+    fxa3 = fxOrderParams.fxa3->getUserValueInt();
+    fxa4 = fxOrderParams.fxa4->getUserValueInt();
+    fxb1 = fxOrderParams.fxb1->getUserValueInt();
+    fxb2 = fxOrderParams.fxb2->getUserValueInt();
+    fxb3 = fxOrderParams.fxb3->getUserValueInt();
+    fxb4 = fxOrderParams.fxb4->getUserValueInt();
+
+    // each 2x section belongs to a run of oversampled effects, so a lane that's rearranged starts its sections over
+    if (laneA != std::array<int, 4>{fxa1, fxa2, fxa3, fxa4})
+        for (auto &section : laneASections)
+            section.reset();
+    if (laneB != std::array<int, 4>{fxb1, fxb2, fxb3, fxb4})
+        for (auto &section : laneBSections)
+            section.reset();
+
+    // the pads follow the layout here, in step with the lanes; the host hears about the total from the message thread
+    if (const auto pads = effectsLatencyFor({fxa1, fxa2, fxa3, fxa4}, {fxb1, fxb2, fxb3, fxb4}, fxOrderParams.chainAtoB->isOn());
+        pads.padA != lanePads.padA || pads.padB != lanePads.padB)
+    {
+        lanePads = pads;
+        for (size_t lane = 0; lane < 2; lane++)
+        {
+            laneDelays[lane].reset();
+            laneDelays[lane].setDelay(static_cast<float>(lane == 0 ? pads.padA : pads.padB));
+        }
     }
 
-    modMatrix.setMonoValue(macroSrc1, modMatrix.getValue(macroParams.macro1));
-    modMatrix.setMonoValue(macroSrc2, modMatrix.getValue(macroParams.macro2));
-    modMatrix.setMonoValue(macroSrc3, modMatrix.getValue(macroParams.macro3));
+    activeEffects.clear();
+    activeEffects.insert(fxa1);
+    activeEffects.insert(fxa2);
+    activeEffects.insert(fxa3);
+    activeEffects.insert(fxa4);
+    activeEffects.insert(fxb1);
+    activeEffects.insert(fxb2);
+    activeEffects.insert(fxb3);
+    activeEffects.insert(fxb4);
 
     if (activeEffects.contains(1))
     {
@@ -1564,8 +1820,6 @@ void PMProcessor::updateParams(int newBlockSize)
         compressor.setMode(static_cast<gin::Dynamics::Type>(compressorParams.type->getUserValueInt()));
     }
 
-    auto &notes = gin::NoteDuration::getNoteDurations();
-
     if (activeEffects.contains(3))
     {
         if (const bool tempoSync = stereoDelayParams.temposync->getUserValue() > 0.0f; !tempoSync)
@@ -1575,8 +1829,8 @@ void PMProcessor::updateParams(int newBlockSize)
         }
         else
         {
-            stereoDelay.setTimeL(notes[static_cast<size_t>(modMatrix.getValue(stereoDelayParams.beatsleft))].toSeconds(playhead));
-            stereoDelay.setTimeR(notes[static_cast<size_t>(modMatrix.getValue(stereoDelayParams.beatsright))].toSeconds(playhead));
+            stereoDelay.setTimeL(transport.noteSeconds(modMatrix.getValue(stereoDelayParams.beatsleft)));
+            stereoDelay.setTimeR(transport.noteSeconds(modMatrix.getValue(stereoDelayParams.beatsright)));
         }
         stereoDelay.setFB(modMatrix.getValue(stereoDelayParams.feedback));
         stereoDelay.setWet(modMatrix.getValue(stereoDelayParams.wet));
@@ -20,20 +20,20 @@
 #include <juce_core/juce_core.h>
 #include <juce_dsp/juce_dsp.h>
 #include <random>
+#include "Decimator.h"
 #include "Envelope.h"
 #include "FXProcessors.h"
+#include "ModFMTables.h"
+#include "ModRouting.h"
+#include "ModulatorBank.h"
+#include "OversampledSection.h"
+#include "ParamSnapshot.h"
 #include "PMSynth.h"
-#include "hiir/PolyphaseIir2Designer.h"
-#if USE_NEON
-#include "hiir/Downsampler2x4Neon.h"
-#include "hiir/Downsampler2xNeon.h"
-#endif
-
-#if USE_SSE
-#include "hiir/Downsampler2xSse.h"
-#endif
+#include "TransportSnapshot.h"
+#include "TuningTable.h"
+
 //==============================================================================
-class PMProcessor : public gin::Processor
+class PMProcessor : public gin::Processor, private gin::Parameter::ParameterListener
 {
   public:
     //==============================================================================
@@ -54,20 +54,52 @@ class PMProcessor : public gin::Processor
     bool hasEditor() const override;
 
     void updateParams(int blockSize);
+    void updateEffectParams();
+    bool effectsModulated() const;
     void setupModMatrix();
 
     void stateUpdated() override;
     void updateState() override;
-
-    void downsampleStage1(const juce::dsp::AudioBlock<float> &inputBlock, juce::dsp::AudioBlock<float> &outputBlock);
-    void downsampleStage2(const juce::dsp::AudioBlock<float> &inputBlock, juce::dsp::AudioBlock<float> &outputBlock);
+    void valueUpdated(gin::Parameter *p) override;
 
     //==============================================================================
 
     //==============================================================================
     juce::Array<float> getLiveFilterCutoff() const;
 
+    // synth core oversampling: 1, 2, 4 or 8
+    void setOversampling(int factor);
+    void updateAutoOversampling(const juce::MidiBuffer &midi);
+    int autoOversamplingFactor(const juce::MidiBuffer &midi) const;
+    void updateLatency();
+    void updateEffectsLatency();
+    gin::BandLimitedLookupTables &tablesForOversampling(int factor);
+    int oversampling{4};
+    Decimator::Mode decimationMode{Decimator::Mode::iir};
+
+    // voice modulation runs every 1st, 2nd, 4th or 8th synth block
+    int getControlDivisor() const { return 1 << globalParams.controlRate->getUserValueInt(); }
+
+    // the synth renders, and modulation is worked out, 16 to 128 samples at a time
+    static constexpr int maxSynthBlockSize = 128;
+    int getSynthBlockSize() const { return 16 << globalParams.synthBlock->getUserValueInt(); }
+
+    // effects run 32 to 256 samples at a time while something modulates them, and a whole buffer at a time otherwise
+    int getFxBlockSize() const { return 32 << globalParams.fxBlock->getUserValueInt(); }
+
     void applyEffects(juce::AudioSampleBuffer &buffer);
+    void processLane(const std::array<int, 4> &slots, juce::AudioSampleBuffer &buffer, std::array<OversampledSection, 2> &sections);
+    void padLane(size_t lane, juce::AudioSampleBuffer &buffer);
+
+    // the lanes' delay, from their trips to 2x and back, and the fractional pads after them that bring the
+    // effects as a whole to a whole number of samples, with the parallel lanes lined up
+    struct EffectsLatency
+    {
+        int total{0};
+        double padA{0.0}, padB{0.0}; // in chain mode only padA is used, after lane B
+    };
+    EffectsLatency effectsLatencyFor(const std::array<int, 4> &laneA, const std::array<int, 4> &laneB, bool chain) const;
+    double laneLatency(const std::array<int, 4> &slots) const;
 
     // Voice Params
     struct OSCParams
@@ -139,7 +171,8 @@ class PMProcessor : public gin::Processor
     {
         GlobalParams() = default;
 
-        gin::Parameter::Ptr mono, glideMode, glideRate, legato, level, mpe, velSens, pitchbendRange, modIndex, modfm, modTone;
+        gin::Parameter::Ptr pan, spread, mono, glideMode, glideRate, legato, level, mpe, velSens, pitchbendRange, modIndex, modfm, modTone,
+            oversampling, decimation, polyphony, multicore, controlRate, synthBlock, fxBlock;
 
         void setup(PMProcessor &p);
 
@@ -216,7 +249,7 @@ class PMProcessor : public gin::Processor
     {
         RingModParams() = default;
 
-        gin::Parameter::Ptr enable, modfreq1, shape1, mix1, modfreq2, shape2, mix2, spread, lowcut, highcut;
+        gin::Parameter::Ptr enable, modfreq1, shape1, mix1, modfreq2, shape2, mix2, spread, lowcut, highcut, oversampling;
 
         void setup(PMProcessor &p);
         int pos{-1};
@@ -276,8 +309,8 @@ class PMProcessor : public gin::Processor
 
     inline void newRand()
     {
-        modMatrix.setMonoValue(randSrc1Mono, dist(gen));
-        modMatrix.setMonoValue(randSrc2Mono, dist(gen));
+        routing.setMonoValue(randSrc1Mono, dist(gen));
+        routing.setMonoValue(randSrc2Mono, dist(gen));
     }
 
     gin::ProcessorOptions getOptions() const;
@@ -327,6 +360,7 @@ class PMProcessor : public gin::Processor
 
     //==============================================================================
     gin::ModMatrix modMatrix;
+    ModRouting routing{modMatrix}; // sources are set through this, so it can evaluate voice modulation itself
 
     gin::LFO lfo1, lfo2, lfo3, lfo4;
     gin::MSEG::Data mseg1Data, mseg2Data, mseg3Data, mseg4Data;
@@ -334,52 +368,55 @@ class PMProcessor : public gin::Processor
     std::array<gin::ModSrcId *, 4> monoLfoIds{&modSrcMonoLFO1, &modSrcMonoLFO2, &modSrcMonoLFO3, &modSrcMonoLFO4};
     std::array<gin::ModSrcId *, 4> polyLfoIds{&modSrcLFO1, &modSrcLFO2, &modSrcLFO3, &modSrcLFO4};
     std::array<gin::ModSrcId *, 4> envSrcIds{&modSrcEnv1, &modSrcEnv2, &modSrcEnv3, &modSrcEnv4};
+    std::array<gin::ModSrcId *, 4> msegSrcIds{&modSrcMSEG1, &modSrcMSEG2, &modSrcMSEG3, &modSrcMSEG4};
+    std::array<OSCParams *, 4> oscParamsByNum{&osc1Params, &osc2Params, &osc3Params, &osc4Params};
+    std::array<LFOParams *, 4> lfoParamsByNum{&lfo1Params, &lfo2Params, &lfo3Params, &lfo4Params};
+    std::array<MSEGParams *, 4> msegParamsByNum{&mseg1Params, &mseg2Params, &mseg3Params, &mseg4Params};
+    ModulatorBank modulators{*this};
 
-    juce::AudioPlayHead *playhead = nullptr;
+    TransportSnapshot transport; // tempo and position, refreshed every host block
     bool presetLoaded = false;
     gin::Filter laneAFilter, laneBFilter;
     juce::dsp::ProcessorDuplicator<juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Coefficients<float>> dcFilter;
     juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> laneAFilterCutoff, laneBFilterCutoff;
-    int fxa1, fxa2, fxa3, fxa4, fxb1, fxb2, fxb3, fxb4; // effect choices
+    int fxa1{}, fxa2{}, fxa3{}, fxa4{}, fxb1{}, fxb2{}, fxb3{}, fxb4{}; // effect choices
+    std::array<OversampledSection, 2> laneASections, laneBSections; // four slots hold at most two oversampled runs
+    int effectsLatency{0};                                           // host samples, as last reported; message thread
+    EffectsLatency lanePads;                                         // as the audio thread last set the pad delays up
+    std::array<juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Thiran>, 2> laneDelays; // lane A, lane B
+    std::vector<gin::Parameter *> effectParams;                     // everything the effects read
+    std::vector<gin::Parameter *> layoutParams;                     // what the effects' latency depends on
+    juce::AudioBuffer<float> laneBBuffer;                            // lane B's copy, when the lanes run in parallel
+    int maxBlockSize{512};                                           // as prepared: the most effects get in one call
     std::unordered_set<int> activeEffects;
 
     gin::LevelTracker levelTracker{20.f};
     PMSynth synth;
-    juce::AudioBuffer<float> synthBuffer;    // 2x
-    juce::AudioBuffer<float> preSynthBuffer; // 4x
+    juce::AudioBuffer<float> osSynthBuffer; // oversampling x
 
     MTSClient *client;
-    juce::String scaleName, learning;
+    TuningTable tuning; // refreshed every host block
+    juce::String learning;
 
-    gin::BandLimitedLookupTables analogTables;
-    gin::BandLimitedLookupTables upsampledTables;
-
-    const int numVoices = 8;
+    gin::BandLimitedLookupTables analogTables;     // 1x
+    gin::BandLimitedLookupTables upsampled2xTables; // 2x
+    gin::BandLimitedLookupTables upsampledTables;   // 4x
+    gin::BandLimitedLookupTables upsampled8xTables; // 8x
+    ModFMTables modfmTables;                        // any rate
+    ParamSnapshot snapshot;                         // refreshed every block
 
     std::random_device rd;
     std::mt19937 gen{rd()};
     std::uniform_real_distribution<float> dist{-1.f, 1.f};
 
-    // antialiasing downsampling filter stuff
-    static constexpr int nbr_coefs1 = 3;
-    static constexpr int nbr_coefs2 = 8;
-    double coefs1[nbr_coefs1];
-    double coefs2[nbr_coefs2];
-
-#if USE_NEON
-    hiir::Downsampler2xNeon<nbr_coefs1> dspl1L, dspl1R;
-    hiir::Downsampler2xNeon<nbr_coefs2> dspl2L, dspl2R;
-#endif
-
-#if USE_SSE
-    hiir::Downsampler2xSse<nbr_coefs1> dspl1L, dspl1R;
-    hiir::Downsampler2xSse<nbr_coefs2> dspl2L, dspl2R;
-#endif
+    // antialiasing downsampling, oversampling x -> 1x
+    Decimator decimator;
 
     bool env1osc1, env1osc2, env1osc3, env1osc4, env2osc1, env2osc2, env2osc3, env2osc4, env3osc1, env3osc2, env3osc3, env3osc4, env4osc1, env4osc2,
         env4osc3, env4osc4;
 
     std::array<double, 1024> convex;
+    std::array<float, 1024> convexF;
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PMProcessor)
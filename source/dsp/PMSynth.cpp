@@ -1,27 +1,40 @@
 #include "PMSynth.h"
 #include "PMProcessor.h"
 
-PMSynth::PMSynth(PMProcessor &proc_) : proc(proc_)
+PMSynth::PMSynth(PMProcessor &proc_) : dispatch(proc_), proc(proc_), pool(proc_)
 {
     enableLegacyMode(12);
     setVoiceStealingEnabled(true);
 
-    for (int i = 0; i < 16; i++)
+    // polyphony is limited by setNumVoices(), so the whole pool is built up front
+    for (int i = 0; i < VoiceBank::maxVoices; i++)
     {
         auto voice = new PMVoice(proc);
+        voice->voiceIndex = i;
         proc.modMatrix.addVoice(voice);
+        dispatch.addVoice(*voice);
         addVoice(voice);
     }
 }
 
+void PMSynth::renderNextSubBlock(juce::AudioBuffer<float> &outputAudio, int startSample, int numSamples)
+{
+    const juce::ScopedLock sl(voicesLock);
+    pool.render(voices, outputAudio, startSample, numSamples);
+}
+
 void PMSynth::handleMidiEvent(const juce::MidiMessage &m)
 {
     MPESynthesiser::handleMidiEvent(m);
 
     if (m.isSysEx())
     {
-        if (MTS_HasMaster(proc.client))
+        // sysex tuning is for when there's no MTS-ESP master to follow
+        if (!MTS_HasMaster(proc.client))
+        {
             MTS_ParseMIDIDataU(proc.client, m.getSysExData(), m.getSysExDataSize());
+            proc.tuning.tuningChanged();
+        }
     }
 
     if (m.isNoteOn())
@@ -33,52 +46,17 @@ void PMSynth::handleMidiEvent(const juce::MidiMessage &m)
     {
         if (m.getControllerNumber() == 1)
         {
-            proc.modMatrix.setMonoValue(proc.modSrcModwheel, float(m.getControllerValue()) / 127.0f);
+            proc.routing.setMonoValue(proc.modSrcModwheel, float(m.getControllerValue()) / 127.0f);
             return;
         }
-        if (proc.macroParams.learning->getUserValueInt() > 0)
-        {
-            int n = proc.macroParams.learning->getUserValueInt();
-            int cc = m.getControllerNumber();
-            if (n == 1)
-            {
-                proc.macroParams.macro1cc->setUserValue(cc);
-            }
-            else if (n == 2)
-            {
-                proc.macroParams.macro2cc->setUserValue(cc);
-            }
-            else if (n == 3)
-            {
-                proc.macroParams.macro3cc->setUserValue(cc);
-            }
-            proc.macroParams.learning->setValue(0.f);
-        }
-        if (m.getControllerNumber() == proc.macroParams.macro1cc->getUserValueInt())
-        {
-            proc.macroParams.macro1->setValue(m.getControllerValue() / 127.0f);
-        }
-        if (m.getControllerNumber() == proc.macroParams.macro2cc->getUserValueInt())
-        {
-            proc.macroParams.macro2->setValue(m.getControllerValue() / 127.0f);
-        }
-        if (m.getControllerNumber() == proc.macroParams.macro3cc->getUserValueInt())
-        {
-            proc.macroParams.macro3->setValue(m.getControllerValue() / 127.0f);
-        }
+        dispatch.handleController(m.getControllerNumber(), m.getControllerValue());
     }
     if (m.isPitchWheel())
     {
-        proc.modMatrix.setMonoValue(proc.modSrcMonoPitchbend, static_cast<float>(m.getPitchWheelValue()) / 0x2000 - 1.0f);
+        proc.routing.setMonoValue(proc.modSrcMonoPitchbend, static_cast<float>(m.getPitchWheelValue()) / 0x2000 - 1.0f);
     }
     if (m.isAftertouch())
     {
-        for (const auto &voice : voices)
-        {
-            if (auto *svoice = dynamic_cast<PMVoice *>(voice); svoice->curNote.initialNote == m.getNoteNumber())
-            {
-                proc.modMatrix.setPolyValue(*svoice, proc.modPolyAT, m.getAfterTouchValue() / 127.0f);
-            }
-        }
+        dispatch.handlePolyAftertouch(m.getNoteNumber(), m.getAfterTouchValue() / 127.0f);
     }
 }
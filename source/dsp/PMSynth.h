@@ -15,7 +15,9 @@
 
 #include <gin_dsp/gin_dsp.h>
 #include <juce_audio_basics/juce_audio_basics.h>
+#include "MidiDispatch.h"
 #include "PMVoice.h"
+#include "RenderPool.h"
 
 class PMProcessor;
 
@@ -27,6 +29,18 @@ class PMSynth : public gin::Synthesiser
 
     void handleMidiEvent(const juce::MidiMessage &m) override;
 
+    void setMaxBlockSize(const int maxSamples) { pool.prepare(maxSamples); }
+    void setTables(gin::BandLimitedLookupTables &tables) { pool.setTables(tables); }
+    void setMultiThreaded(const bool shouldBe) { pool.setMultiThreaded(shouldBe); }
+
+    bool isAnyVoiceActive() const
+    {
+        for (const auto v : voices)
+            if (v->isActive())
+                return true;
+        return false;
+    }
+
     inline juce::Array<float> getLiveFilterCutoff() const
     {
         juce::Array<float> values;
@@ -222,6 +236,12 @@ class PMSynth : public gin::Synthesiser
         return states;
     }
 
+    MidiDispatch dispatch; // routes controllers and poly aftertouch; voices keep its note table up to date
+
+  protected:
+    void renderNextSubBlock(juce::AudioBuffer<float> &outputAudio, int startSample, int numSamples) override;
+
   private:
     PMProcessor &proc;
+    RenderPool pool;
 };
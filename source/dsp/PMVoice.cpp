@@ -7,18 +7,15 @@
 // 0.5f)) };
 // }
 
-float PMVoice::Averager::in;
-
 //==============================================================================
 PMVoice::PMVoice(PMProcessor &p)
-    : proc(p), mseg1(proc.mseg1Data), mseg2(proc.mseg2Data), mseg3(proc.mseg3Data), mseg4(proc.mseg4Data), env1(p.convex), env2(p.convex),
-      env3(p.convex), env4(p.convex), bllt(p.upsampledTables)
+    : proc(p), mseg1(proc.mseg1Data), mseg2(proc.mseg2Data), mseg3(proc.mseg3Data), mseg4(proc.mseg4Data), env1(p.convex, p.convexF),
+      env2(p.convex, p.convexF), env3(p.convex, p.convexF), env4(p.convex, p.convexF)
 {
     mseg1.reset();
     mseg2.reset();
     mseg3.reset();
     mseg4.reset();
-    filter.setNumChannels(2);
 }
 
 void PMVoice::noteStarted()
@@ -27,14 +24,17 @@ void PMVoice::noteStarted()
 
     curNote = getCurrentlyPlayingNote();
 
-    proc.modMatrix.setPolyValue(*this, proc.randSrc1Poly, static_cast<float>(dist(gen)));
-    proc.modMatrix.setPolyValue(*this, proc.randSrc2Poly, static_cast<float>(dist(gen)));
+    proc.routing.setPolyValue(*this, proc.randSrc1Poly, proc.dist(proc.gen));
+    proc.routing.setPolyValue(*this, proc.randSrc2Poly, proc.dist(proc.gen));
+    spreadPos = proc.dist(proc.gen);
+    lastGainL = lastGainR = -1.f;
 
     if (MTS_ShouldFilterNote(proc.client, static_cast<char>(curNote.initialNote), static_cast<char>(curNote.midiChannel)))
     {
         return;
     }
 
+    proc.synth.dispatch.noteStarted(*this, curNote.initialNote);
     fastKill = false;
     startVoice();
 
@@ -50,42 +50,40 @@ void PMVoice::noteStarted()
         noteSmoother.setValueUnsmoothed(note.initialNote / 127.0f);
     }
 
-    proc.modMatrix.setPolyValue(*this, proc.modSrcVelocity, note.noteOnVelocity.asUnsignedFloat());
-    proc.modMatrix.setPolyValue(*this, proc.modSrcTimbre, note.initialTimbre.asUnsignedFloat());
-    proc.modMatrix.setPolyValue(*this, proc.modSrcPressure, note.pressure.asUnsignedFloat());
+    proc.routing.setPolyValue(*this, proc.modSrcVelocity, note.noteOnVelocity.asUnsignedFloat());
+    proc.routing.setPolyValue(*this, proc.modSrcTimbre, note.initialTimbre.asUnsignedFloat());
+    proc.routing.setPolyValue(*this, proc.modSrcPressure, note.pressure.asUnsignedFloat());
 
     juce::ScopedValueSetter<bool> svs(disableSmoothing, true);
 
-    filter.reset();
-
-    fnz1 = proc.filterParams.frequency->getUserValue(); // in midi note #
-    const float q = gin::Q / (1.0f - (proc.filterParams.resonance->getUserValue() / 100.0f) * 0.99f);
-    fqz1 = q;
+    filterState = {};
+    filterIdle = true;
 
-    lfo1.reset();
-    lfo2.reset();
-    lfo3.reset();
-    lfo4.reset();
+    proc.modulators.resetLFOs(voiceIndex);
 
+    updateModulators(0);
     updateParams(0);
     snapParams();
+    updateModulators(0); // again, now that the envelopes have an output
     updateParams(0);
     snapParams();
+    snapRamps();
 
-    lfo1.noteOn();
-    lfo2.noteOn();
-    lfo3.noteOn();
-    lfo4.noteOn();
+    proc.modulators.startLFOs(voiceIndex);
 
     env1.noteOn();
     env2.noteOn();
     env3.noteOn();
     env4.noteOn();
 
-    phase1 = lastp1 = proc.osc1Params.phase->getUserValue();
-    phase2 = lastp2 = proc.osc2Params.phase->getUserValue();
-    phase3 = lastp3 = proc.osc3Params.phase->getUserValue();
-    phase4 = lastp4 = proc.osc4Params.phase->getUserValue();
+    lastp1 = proc.osc1Params.phase->getUserValue();
+    phase1 = toPhase(lastp1);
+    lastp2 = proc.osc2Params.phase->getUserValue();
+    phase2 = toPhase(lastp2);
+    lastp3 = proc.osc3Params.phase->getUserValue();
+    phase3 = toPhase(lastp3);
+    lastp4 = proc.osc4Params.phase->getUserValue();
+    phase4 = toPhase(lastp4);
 
     mseg1.noteOn();
     mseg2.noteOn();
@@ -99,8 +97,8 @@ void PMVoice::noteRetriggered()
     const auto note = getCurrentlyPlayingNote();
     curNote = getCurrentlyPlayingNote();
 
-    proc.modMatrix.setPolyValue(*this, proc.randSrc1Poly, static_cast<float>(dist(gen)));
-    proc.modMatrix.setPolyValue(*this, proc.randSrc2Poly, static_cast<float>(dist(gen)));
+    proc.routing.setPolyValue(*this, proc.randSrc1Poly, proc.dist(proc.gen));
+    proc.routing.setPolyValue(*this, proc.randSrc2Poly, proc.dist(proc.gen));
 
     if (glideInfo.fromNote >= 0 && (glideInfo.glissando || glideInfo.portamento))
     {
@@ -112,10 +110,11 @@ void PMVoice::noteRetriggered()
         noteSmoother.setValueUnsmoothed(note.initialNote / 127.0f);
     }
 
-    proc.modMatrix.setPolyValue(*this, proc.modSrcVelocity, note.noteOnVelocity.asUnsignedFloat());
-    proc.modMatrix.setPolyValue(*this, proc.modSrcTimbre, note.initialTimbre.asUnsignedFloat());
-    proc.modMatrix.setPolyValue(*this, proc.modSrcPressure, note.pressure.asUnsignedFloat());
+    proc.routing.setPolyValue(*this, proc.modSrcVelocity, note.noteOnVelocity.asUnsignedFloat());
+    proc.routing.setPolyValue(*this, proc.modSrcTimbre, note.initialTimbre.asUnsignedFloat());
+    proc.routing.setPolyValue(*this, proc.modSrcPressure, note.pressure.asUnsignedFloat());
 
+    updateModulators(0);
     updateParams(0);
 
     env1.noteOn();
@@ -123,20 +122,14 @@ void PMVoice::noteRetriggered()
     env3.noteOn();
     env4.noteOn();
 
-    lfo1.reset();
-    lfo2.reset();
-    lfo3.reset();
-    lfo4.reset();
+    proc.modulators.resetLFOs(voiceIndex);
 
-    phase1 = proc.osc1Params.phase->getUserValue();
-    phase2 = proc.osc2Params.phase->getUserValue();
-    phase3 = proc.osc3Params.phase->getUserValue();
-    phase4 = proc.osc4Params.phase->getUserValue();
+    phase1 = toPhase(proc.osc1Params.phase->getUserValue());
+    phase2 = toPhase(proc.osc2Params.phase->getUserValue());
+    phase3 = toPhase(proc.osc3Params.phase->getUserValue());
+    phase4 = toPhase(proc.osc4Params.phase->getUserValue());
 
-    lfo1.noteOn();
-    lfo2.noteOn();
-    lfo3.noteOn();
-    lfo4.noteOn();
+    proc.modulators.startLFOs(voiceIndex);
 
     mseg1.noteOn();
     mseg2.noteOn();
@@ -151,9 +144,10 @@ void PMVoice::noteStopped(bool allowTailOff)
     env3.noteOff();
     env4.noteOff();
     curNote = getCurrentlyPlayingNote();
-    proc.modMatrix.setPolyValue(*this, proc.modSrcVelOff, curNote.noteOffVelocity.asUnsignedFloat());
+    proc.routing.setPolyValue(*this, proc.modSrcVelOff, curNote.noteOffVelocity.asUnsignedFloat());
     if (!allowTailOff)
     {
+        proc.synth.dispatch.noteStopped(*this);
         clearCurrentNote();
         stopVoice();
     }
@@ -162,29 +156,19 @@ void PMVoice::noteStopped(bool allowTailOff)
 void PMVoice::notePressureChanged()
 {
     const auto note = getCurrentlyPlayingNote();
-    proc.modMatrix.setPolyValue(*this, proc.modSrcPressure, note.pressure.asUnsignedFloat());
+    proc.routing.setPolyValue(*this, proc.modSrcPressure, note.pressure.asUnsignedFloat());
 }
 
 void PMVoice::noteTimbreChanged()
 {
     const auto note = getCurrentlyPlayingNote();
-    proc.modMatrix.setPolyValue(*this, proc.modSrcTimbre, note.timbre.asUnsignedFloat());
+    proc.routing.setPolyValue(*this, proc.modSrcTimbre, note.timbre.asUnsignedFloat());
 }
 
 void PMVoice::setCurrentSampleRate(double newRate)
 {
     MPESynthesiserVoice::setCurrentSampleRate(newRate);
 
-    const auto quarter = newRate * 0.25;
-
-    filter.setSampleRate(newRate);
-    noteSmoother.setSampleRate(quarter);
-
-    lfo1.setSampleRate(quarter);
-    lfo2.setSampleRate(quarter);
-    lfo3.setSampleRate(quarter);
-    lfo4.setSampleRate(quarter);
-
     env1.setSampleRate(newRate);
     env2.setSampleRate(newRate);
     env3.setSampleRate(newRate);
@@ -196,190 +180,215 @@ void PMVoice::setCurrentSampleRate(double newRate)
     env3.setParameters(p);
     env4.setParameters(p);
 
-    mseg1.setSampleRate(quarter);
-    mseg2.setSampleRate(quarter);
-    mseg3.setSampleRate(quarter);
-    mseg4.setSampleRate(quarter);
-
-    fnb1 = std::exp(-2.0 * pi * 3500 / quarter);
-    fna0 = 1 - fnb1;
-    fnz1 = 95; // proc.filterParams.frequency->getUserValue();
-    fqb1 = fnb1;
-    fqa0 = fna0;
-    fqz1 = 0; // proc.filterParams.resonance->getUserValue();
+    controlDivisor = proc.getControlDivisor();
+    setControlRate();
+}
+
+// the modulators run once per control tick, i.e. every 'controlDivisor' blocks
+void PMVoice::setControlRate()
+{
+    const auto controlRate = getSampleRate() / controlDivisor;
+
+    noteSmoother.setSampleRate(controlRate);
+
+    proc.modulators.setControlRate(voiceIndex, controlRate);
+
+    mseg1.setSampleRate(controlRate);
+    mseg2.setSampleRate(controlRate);
+    mseg3.setSampleRate(controlRate);
+    mseg4.setSampleRate(controlRate);
 }
 
-float PMVoice::w(gin::Wave sel, float ph, float freq, bool isMod)
+void PMVoice::renderNextBlock(juce::AudioBuffer<float> & /*outputBuffer*/, int /*startSample*/, int /*numSamples*/)
 {
-    while (ph >= 1.0f)
-        ph -= 1.0f;
-    while (ph < 0.0f)
-        ph += 1.0f;
-    float out = bllt.process(sel, freq, ph);
-    if (proc.globalParams.modfm->isOn() && isMod)
+    jassertfalse; // never called: PMSynth's render pool renders all the voices together
+}
+
+// the voice's own sources, which have to be in place before the routing is evaluated
+void PMVoice::updateSources()
+{
+    proc.routing.setPolyValue(*this, proc.modSrcNote, getCurrentlyPlayingNote().initialNote / 127.0f);
+    proc.routing.setPolyValue(*this, proc.modSrcEnv1, env1.getOutput());
+    proc.routing.setPolyValue(*this, proc.modSrcEnv2, env2.getOutput());
+    proc.routing.setPolyValue(*this, proc.modSrcEnv3, env3.getOutput());
+    proc.routing.setPolyValue(*this, proc.modSrcEnv4, env4.getOutput());
+}
+
+// sources, LFOs and MSEGs, then the modulated parameters that depend on them
+void PMVoice::updateModulators(const int blockSize)
+{
+    PMVoice *self = this;
+    updateSources();
+    proc.modulators.process(&self, 1, blockSize);
+    proc.routing.evaluate(&self, 1, controlDivisor * blockSize / getSampleRate());
+}
+
+void PMVoice::startRender(const int numSamples, const bool controlTick)
+{
+    if (const int divisor = proc.getControlDivisor(); divisor != controlDivisor)
     {
-        return std::exp(out) * 0.850918 - 1.313035;
+        controlDivisor = divisor;
+        setControlRate();
     }
-    else
+
+    if (controlTick)
+        updateParams(numSamples);
+    phase1 += toPhase(b1); // bumps
+    phase2 += toPhase(b2);
+    phase3 += toPhase(b3);
+    phase4 += toPhase(b4);
+    advanceRamps(numSamples);
+    updateOpMask();
+}
+
+// the operators' target frequencies, from the gliding note, the pitch bend and each operator's tuning;
+// also called straight from the synth when an MPE note's bend changes, to ramp there over the rest of the tick
+void PMVoice::updatePitch()
+{
+    const auto note = getCurrentlyPlayingNote();
+
+    currentMidiNote = noteSmoother.getCurrentValue() * 127.0f;
+    if (glideInfo.glissando)
+        currentMidiNote = (float)juce::roundToInt(currentMidiNote);
+
+    const int wholeNote = static_cast<int>(currentMidiNote);
+    const float bend = note.totalPitchbendInSemitones * (proc.globalParams.pitchbendRange->getUserValue() / 2.0f);
+    float baseFreq = proc.tuning.frequency(wholeNote, note.midiChannel);
+    baseFreq *= FastMath<float>::fastExp2((bend + currentMidiNote - float(wholeNote)) / 12.0f);
+    baseFreq = juce::jlimit(20.0f, 20000.f, baseFreq * pitchScale);
+
+    for (size_t op = 0; op < 4; op++)
+        freqs[op] = opFixed[op] ? opTuning[op] * 100.f : baseFreq * opTuning[op];
+}
+
+void PMVoice::notePitchbendChanged()
+{
+    if (isActive())
+        updatePitch();
+}
+
+void PMVoice::advanceRamps(const int numSamples)
+{
+    volRamps[0].target = vol1;
+    volRamps[1].target = vol2;
+    volRamps[2].target = vol3;
+    volRamps[3].target = vol4;
+    modIndexRamp.target = modIndex;
+    for (size_t op = 0; op < 4; op++)
+        freqRamps[op].target = freqs[op];
+
+    for (auto &r : volRamps)
+        r.advance(rampLeft, numSamples);
+    for (auto &r : freqRamps)
+        r.advance(rampLeft, numSamples);
+    modIndexRamp.advance(rampLeft, numSamples);
+    filterG.advance(rampLeft, numSamples);
+    filterK.advance(rampLeft, numSamples);
+    rampLeft = std::max(0, rampLeft - numSamples);
+}
+
+void PMVoice::snapRamps()
+{
+    volRamps[0].target = vol1;
+    volRamps[1].target = vol2;
+    volRamps[2].target = vol3;
+    volRamps[3].target = vol4;
+    modIndexRamp.target = modIndex;
+    for (size_t op = 0; op < 4; op++)
+        freqRamps[op].target = freqs[op];
+
+    for (auto &r : volRamps)
+        r.snap();
+    for (auto &r : freqRamps)
+        r.snap();
+    modIndexRamp.snap();
+    filterG.snap();
+    filterK.snap();
+    rampLeft = 0;
+}
+
+void PMVoice::applyPendingStop()
+{
+    if (stopPending)
     {
-        return out;
+        stopPending = false;
+        proc.synth.dispatch.noteStopped(*this);
+        clearCurrentNote();
+        stopVoice();
     }
 }
 
-void PMVoice::renderNextBlock(juce::AudioBuffer<float> &outputBuffer, int startSample, int numSamples)
+void PMVoice::updateOpMask()
 {
-    updateParams(numSamples);
-    phase1 += b1; // bumps
-    phase2 += b2;
-    phase3 += b3;
-    phase4 += b4;
-    synthBuffer.setSize(2, numSamples, false, false, true);
-    auto synthBufferL = synthBuffer.getWritePointer(0);
-    auto synthBufferR = synthBuffer.getWritePointer(1);
-    double invSampleRate = 1.0 / currentSampleRate;
-
-    for (int i = 0; i < numSamples; i++)
+    const auto a = size_t(juce::jlimit(0, numAlgorithms - 1, algo));
+
+    // modulators always have higher numbers than what they modulate, so one pass
+    // from osc 1 up finds everything that is live and reaches an output
+    opMask = 0;
+    for (size_t op = 0; op < 4; op++)
     {
-        env1.getNextSample(); // advances env
-        env2.getNextSample();
-        env3.getNextSample();
-        env4.getNextSample();
-        auto e1 = envs[0]->getOutput(); // different envelope can be chosen for each osc
-        auto e2 = envs[1]->getOutput(); // so "e1" means "the output of the envelope selected for osc 1"
-        auto e3 = envs[2]->getOutput();
-        auto e4 = envs[3]->getOutput();
-
-        float out{0}, out1{0}, out2{0}, out3{0}, out4{0};
-        phase4 += freq4 * invSampleRate;
-        phase4 = phase4 - (int)phase4;
-        phase3 += freq3 * invSampleRate;
-        phase3 = phase3 - (int)phase3;
-        phase2 += freq2 * invSampleRate;
-        phase2 = phase2 - (int)phase2;
-        phase1 += freq1 * invSampleRate;
-        phase1 = phase1 - (int)phase1;
-
-        // clang-format off
-		switch(algo) {
-		case 0: {
-			out =	e1 * v1.p(vol1) * w(w1, phase1 +
-					e2 * v2.p(vol2) * modIndex * a2.p(w(w2, phase2 + // only average ops that are modulators
-					e3 * v3.p(vol3) * modIndex * a3.p(w(w3, phase3 +
-					e4 * v4.p(vol4) * modIndex * a4.p(w(w4, phase4, 
-                        freq4, true)), 
-                        freq3, true)), 
-                        freq2, true)),
-                        freq1, false
-                    );
-			break;
-			}
-		case 1: {
-			out =	e1 * vol1 * w(w1, phase1 +
-					e2 * vol2 * modIndex *  a2.p(w(w2, phase2 +
-					(e3 * vol3 * modIndex * a3.p(w(w3, phase3, 
-                        freq3, true))) +
-					(e4 * vol4 * modIndex * a4.p(w(w4, phase4, 
-                        freq4, true))), 
-                        freq2, true)),
-                        freq1, false
-                    );
-            break;
-			}
-		case 2: {
-			out =	e1 * vol1 * w(w1, phase1 +
-					(e2 * vol2 * modIndex * a2.p(w(w2, phase2 + 
-					e3 * vol3 * modIndex *  a3.p(w(w3, phase3, freq3, true)), freq2, true))) +
-					e4 * vol4 * modIndex *  a4.p(w(w4, phase4, freq4, true)), freq1, true);
-            break;
-			}
-		case 3: {
-			auto p4 = e4 * vol4 * modIndex * a4.p(w(w4, phase4, 
-                freq4, true));
-			auto p3 = e3 * vol3 * modIndex * a3.p(w(w3, phase3 + p4, 
-                freq3, true));
-			auto p2 = e2 * vol2 * modIndex * a2.p(w(w2, phase2 + p4, 
-                freq2, true));
-			out = e1 * vol1 * w(w1, phase1 + p2 + p3, freq1, false);
-            break;
-			}
-		case 4: {
-			auto p43 = e3 * vol3 * modIndex * a3.p(w(w3, phase3 + e4 * vol4 * modIndex * a4.p(w(w4, phase4, 
-                freq4, true)), 
-                freq3, true));
-			out2 = e2 * vol2 * w(w2, phase2 + p43, freq2, false);
-			out1 = e1 * vol1 * w(w1, phase1 + p43, freq1, false);
-            out = (out1 + out2) * 0.5f;
-			break;
-			}
-		case 5: {
-			out2 = e2 * vol2 * w(w2, phase2 + e3 * vol3 * modIndex * a3.p(w(w3, phase3 + 
-				e4 * vol4 * modIndex * a4.p(w(w4, phase4, freq4, true)),
-                freq3, true)),
-                freq2, true);
-			out1 = e1 * vol1 * w(w1, phase1, freq1, false);
-            out = (out1 + out2) * 0.5f;
-			break;
-			}
-		case 6: {
-			auto p4 = e4 * vol4 * modIndex * a4.p(w(w4, phase4, freq4, true));
-			auto p3 = e3 * vol3 * modIndex * a3.p(w(w3, phase3, freq3, true));
-			auto p2 = e2 * vol2 * modIndex * a2.p(w(w2, phase2, freq2, true));
-			out1 = e1 * vol1 * w(w1, phase1 + p2 + p3 + p4, freq1, false);
-            out = out1;
-			break;
-			}
-		case 7: {
-			out1 = e1 * vol1 * w(w1, phase1 + e2 * vol2 * modIndex * a2.p(w(w2, phase2, freq2, true)), freq1, false);
-			out3 = e3 * vol3 * w(w3, phase3 + e4 * vol4 * modIndex * a4.p(w(w4, phase4, freq4, true)), freq3, false);
-			out = (out1 + out3) * 0.5f;
-            break;
-			}
-		case 8: {
-			auto p4 = e4 * vol4 * modIndex * a4.p(w(w4, phase4, freq4, true));
-			out3 = e3 * vol3 * w(w3, phase3 + p4, freq3, false);
-			out2 = e2 * vol2 * w(w2, phase2 + p4, freq2, false);
-			out1 = e1 * vol1 * w(w1, phase1 + p4, freq1, false);
-            out = (out1 + out2 + out3) * 0.3333333333333333f;
-			break;
-			}
-		case 9: {
-			out3 = e3 * vol3 * w(w3, phase3 + e4 * vol4 * modIndex * a4.p(w(w4, phase4, 
-                freq4, true)), freq3, true);
-			out2 = e2 * vol2 * w(w2, phase2, freq2, false);
-			out1 = e1 * vol1 * w(w1, phase1, freq1, false);
-            out = (out1 + out2 + out3) * 0.3333333333333333f;
-			break;
-			}
-		case 10: {
-			out4 = e4 * vol4 * w(w4, phase4, freq4, false);
-			out3 = e3 * vol3 * w(w3, phase3, freq3, false);
-			out2 = e2 * vol2 * w(w2, phase2, freq2, false);
-			out1 = e1 * vol1 * w(w1, phase1, freq1, false);
-            out = (out1 + out2 + out3 + out4) * 0.25f;
-			break;
-			}
-		default: {
-			out = 0;
-			break;
-			}
-		}
-
-		synthBufferL[i] = out * antipop;
-		synthBufferR[i] = out * antipop;
-        
-        antipop += .03f;
-		antipop = std::min(antipop, 1.0f);
-        // clang-format on
+        const bool audible = volRamps[op].start > 0.f || volRamps[op].current > 0.f;
+        const bool reaches = (carriers[a] >> op) & 1 || (targets[a][op] & opMask) != 0;
+        if (audible && envs[op]->isActive() && reaches)
+            opMask |= 1 << op;
     }
+}
 
-    // Get and apply velocity according to keytrack param
-    float velocity = currentlyPlayingNote.noteOnVelocity.asUnsignedFloat();
-    float ampKeyTrack = getValue(proc.globalParams.velSens);
-    synthBuffer.applyGain(gin::velocityToGain(velocity, ampKeyTrack) * baseAmplitude);
+// true once every output operator is inaudible and can't come back by itself
+bool PMVoice::carriersSilent() const
+{
+    constexpr float threshold = 0.00001f; // -100 dB
+    const auto a = size_t(juce::jlimit(0, numAlgorithms - 1, algo));
 
-    filter.process(synthBuffer);
+    for (size_t op = 0; op < 4; op++)
+    {
+        if (((carriers[a] >> op) & 1) == 0)
+            continue;
+        const auto *env = envs[op];
+        if (env->isActive() && !env->isReleasing())
+            return false;
+        if (volRamps[op].current * env->getOutput() >= threshold)
+            return false;
+    }
+    return true;
+}
+
+void PMVoice::renderEnvelopes(float *scratch, const int scratchSize, float *dest, const int stride, const int opStride, const int numSamples)
+{
+    for (size_t e = 0; e < 4; e++)
+        envsByNum[e]->processBlock(scratch + e * size_t(scratchSize), numSamples);
+
+    // different envelope can be chosen for each osc
+    for (size_t op = 0; op < 4; op++)
+    {
+        const size_t e = static_cast<size_t>(std::find(envsByNum.begin(), envsByNum.end(), envs[op]) - envsByNum.begin());
+        const float *src = scratch + e * size_t(scratchSize);
+        float *d = dest + op * size_t(opStride);
+        for (int i = 0; i < numSamples; i++)
+            d[i * stride] = src[i];
+    }
+}
+
+void PMVoice::finishRender(juce::AudioBuffer<float> &synthBuffer, juce::AudioBuffer<float> &outputBuffer, int startSample, int numSamples)
+{
+    // with no live output operator the block is silent, and once the filter
+    // has rung out there is nothing left to process or mix
+    const bool silent = (opMask & carriers[size_t(juce::jlimit(0, numAlgorithms - 1, algo))]) == 0;
+    const bool skip = silent && filterIdle;
+    float magnitude = 0.f;
+
+    // velocity according to keytrack param, applied when mixing
+    const float velocity = currentlyPlayingNote.noteOnVelocity.asUnsignedFloat();
+    const float ampKeyTrack = param(proc.globalParams.velSens);
+    const float gain = gin::velocityToGain(velocity, ampKeyTrack) * baseAmplitude;
+
+    if (!skip)
+    {
+        magnitude = synthBuffer.getMagnitude(0, 0, numSamples) * gain;
+        filterIdle = silent && magnitude < 0.000001f;
+    }
 
-    bool voiceShouldStop = false;
+    bool voiceShouldStop = magnitude < 0.00001f && carriersSilent();
     if (algo == 0 || algo == 1 || algo == 2 || algo == 4 || algo == 6)
     {
         if (!envsByNum[0]->isActive())
@@ -416,455 +425,205 @@ void PMVoice::renderNextBlock(juce::AudioBuffer<float> &outputBuffer, int startS
         }
     }
 
-    if (voiceShouldStop)
+    // this may run on a worker thread, so stopping the voice is left to the audio thread
+    stopPending = voiceShouldStop;
+
+    // Pan the mono voice into the output
+    if (!skip)
     {
-        clearCurrentNote();
-        stopVoice();
+        const float pan = juce::jlimit(-1.f, 1.f, param(proc.globalParams.pan) + param(proc.globalParams.spread) * spreadPos);
+        const float gainL = gain * std::min(1.f - pan, 1.f);
+        const float gainR = gain * std::min(1.f + pan, 1.f);
+        if (lastGainL < 0.f)
+        {
+            lastGainL = gainL;
+            lastGainR = gainR;
+        }
+        outputBuffer.addFromWithRamp(0, startSample, synthBuffer.getReadPointer(0), numSamples, lastGainL, gainL);
+        outputBuffer.addFromWithRamp(1, startSample, synthBuffer.getReadPointer(0), numSamples, lastGainR, gainR);
+        lastGainL = gainL;
+        lastGainR = gainR;
     }
 
-    // Copy synth voice to output
-    outputBuffer.addFrom(0, startSample, synthBuffer, 0, 0, numSamples);
-    outputBuffer.addFrom(1, startSample, synthBuffer, 1, 0, numSamples);
-
     finishBlock(numSamples);
 }
 
-void PMVoice::updateParams(int blockSize)
+// unmodulated parameters come straight from the processor's snapshot, and modulated
+// voice parameters from the values ModRouting worked out on the last control tick
+float PMVoice::param(gin::Parameter *p)
 {
-    if (tilUpdate != 0)
-    {
-        --tilUpdate;
-        return;
-    } // at 4x os, we don't need this every block
-    else
-    {
-        tilUpdate = 3;
-    } // every 4th to match envelope/lfo/mseg
-
-    vol1 = getValue(proc.osc1Params.volume);
-    vol2 = getValue(proc.osc2Params.volume);
-    vol3 = getValue(proc.osc3Params.volume);
-    vol4 = getValue(proc.osc4Params.volume);
+    if (proc.routing.isPoly(p))
+        return proc.routing.isRouted(p) ? proc.routing.value(voiceIndex, p) : proc.snapshot.value(p);
+    return proc.snapshot.isModulated(p) ? getValue(p) : proc.snapshot.value(p);
+}
 
+void PMVoice::updateSettings()
+{
     algo = proc.timbreParams.algo->getUserValueInt();
     w1 = waveForChoice(proc.osc1Params.wave->getUserValueInt());
     w2 = waveForChoice(proc.osc2Params.wave->getUserValueInt());
     w3 = waveForChoice(proc.osc3Params.wave->getUserValueInt());
     w4 = waveForChoice(proc.osc4Params.wave->getUserValueInt());
 
-    modIndex = getValue(proc.globalParams.modIndex);
-    Averager::in = getValue(proc.globalParams.modTone);
-
-    auto note = getCurrentlyPlayingNote();
-
-    proc.modMatrix.setPolyValue(*this, proc.modSrcNote, note.initialNote / 127.0f);
-
-    currentMidiNote = noteSmoother.getCurrentValue() * 127.0f;
-    if (glideInfo.glissando)
-        currentMidiNote = (float)juce::roundToInt(currentMidiNote);
-
-    float dummy;
-    float remainder = std::modf(currentMidiNote, &dummy);
-    float baseFreq = static_cast<float>(MTS_NoteToFrequency(proc.client, static_cast<char>(currentMidiNote), note.midiChannel));
-    baseFreq *= static_cast<float>(
-        std::pow(1.05946309436f, note.totalPitchbendInSemitones * (proc.globalParams.pitchbendRange->getUserValue() / 2.0f) + remainder));
-    baseFreq = juce::jlimit(20.0f, 20000.f, baseFreq * getValue(proc.timbreParams.pitch));
-
-    if (proc.osc1Params.fixed->isOn())
-    {
-        freq1 = ((int)(getValue(proc.osc1Params.coarse) + 0.0001f) + getValue(proc.osc1Params.fine)) * 100.f;
-    }
-    else
-    {
-        freq1 = baseFreq * ((int)(getValue(proc.osc1Params.coarse) + 0.0001f) + getValue(proc.osc1Params.fine));
-    }
-    if (proc.osc2Params.fixed->isOn())
-    {
-        freq2 = ((int)(getValue(proc.osc2Params.coarse) + 0.0001f) + getValue(proc.osc2Params.fine)) * 100.f;
-        freq2factor = freq1 / freq2;
-    }
-    else
-    {
-        freq2 = baseFreq * ((int)(getValue(proc.osc2Params.coarse) + 0.0001f) + getValue(proc.osc2Params.fine));
-        freq2factor = ((int)(getValue(proc.osc2Params.coarse) + 0.0001f) + getValue(proc.osc2Params.fine));
-    }
-    if (proc.osc3Params.fixed->isOn())
-    {
-        freq3 = ((int)(getValue(proc.osc3Params.coarse) + 0.0001f) + getValue(proc.osc3Params.fine)) * 100.f;
-        freq3factor = freq1 / freq3;
-    }
-    else
-    {
-        freq3 = baseFreq * ((int)(getValue(proc.osc3Params.coarse) + 0.0001f) + getValue(proc.osc3Params.fine));
-        freq3factor = ((int)(getValue(proc.osc3Params.coarse) + 0.0001f) + getValue(proc.osc3Params.fine));
-    }
-    if (proc.osc4Params.fixed->isOn())
-    {
-        freq4 = ((int)(getValue(proc.osc4Params.coarse) + 0.0001f) + getValue(proc.osc4Params.fine)) * 100.f;
-        freq4factor = freq1 / freq4;
-    }
-    else
-    {
-        freq4 = baseFreq * ((int)(getValue(proc.osc4Params.coarse) + 0.0001f) + getValue(proc.osc4Params.fine));
-        freq4factor = ((int)(getValue(proc.osc4Params.coarse) + 0.0001f) + getValue(proc.osc4Params.fine));
-    }
+    // different envelope can be chosen for each osc
+    envs[0] = envsByNum[size_t(juce::jlimit(0, 3, proc.osc1Params.env->getUserValueInt()))];
+    envs[1] = envsByNum[size_t(juce::jlimit(0, 3, proc.osc2Params.env->getUserValueInt()))];
+    envs[2] = envsByNum[size_t(juce::jlimit(0, 3, proc.osc3Params.env->getUserValueInt()))];
+    envs[3] = envsByNum[size_t(juce::jlimit(0, 3, proc.osc4Params.env->getUserValueInt()))];
+}
 
-    switch (proc.osc1Params.env->getUserValueInt())
-    {
-    case 0:
-        envs[0] = &env1;
-        break;
-    case 1:
-        envs[0] = &env2;
-        break;
-    case 2:
-        envs[0] = &env3;
-        break;
-    case 3:
-        envs[0] = &env4;
-        break;
-    }
+// runs once per control tick, after the sources are set and the routing evaluated
+void PMVoice::updateParams(int blockSize)
+{
+    rampLeft = controlDivisor * blockSize; // ramp towards the new values until the next update
+    vol1 = param(proc.osc1Params.volume);
+    vol2 = param(proc.osc2Params.volume);
+    vol3 = param(proc.osc3Params.volume);
+    vol4 = param(proc.osc4Params.volume);
 
-    switch (proc.osc2Params.env->getUserValueInt())
+    // settings that can't be modulated only need looking at when something changed
+    if (seenVersion != proc.snapshot.version)
     {
-    case 0:
-        envs[1] = &env1;
-        break;
-    case 1:
-        envs[1] = &env2;
-        break;
-    case 2:
-        envs[1] = &env3;
-        break;
-    case 3:
-        envs[1] = &env4;
-        break;
+        seenVersion = proc.snapshot.version;
+        updateSettings();
     }
 
-    switch (proc.osc3Params.env->getUserValueInt())
-    {
-    case 0:
-        envs[2] = &env1;
-        break;
-    case 1:
-        envs[2] = &env2;
-        break;
-    case 2:
-        envs[2] = &env3;
-        break;
-    case 3:
-        envs[2] = &env4;
-        break;
-    }
+    modIndex = param(proc.globalParams.modIndex);
+    a2.in = a3.in = a4.in = param(proc.globalParams.modTone);
 
-    switch (proc.osc4Params.env->getUserValueInt())
+    pitchScale = param(proc.timbreParams.pitch);
+    for (size_t op = 0; op < 4; op++)
     {
-    case 0:
-        envs[3] = &env1;
-        break;
-    case 1:
-        envs[3] = &env2;
-        break;
-    case 2:
-        envs[3] = &env3;
-        break;
-    case 3:
-        envs[3] = &env4;
-        break;
+        const auto &osc = *proc.oscParamsByNum[op];
+        opTuning[op] = (int)(param(osc.coarse) + 0.0001f) + param(osc.fine);
+        opFixed[op] = osc.fixed->isOn();
     }
+    updatePitch();
 
-    auto phaseParam = getValue(proc.osc1Params.phase);
+    auto phaseParam = param(proc.osc1Params.phase);
     b1 = phaseParam - lastp1; // bumps
     lastp1 = phaseParam;
 
-    phaseParam = getValue(proc.osc2Params.phase);
+    phaseParam = param(proc.osc2Params.phase);
     b2 = phaseParam - lastp2;
     lastp2 = phaseParam;
 
-    phaseParam = getValue(proc.osc3Params.phase);
+    phaseParam = param(proc.osc3Params.phase);
     b3 = phaseParam - lastp3;
     lastp3 = phaseParam;
 
-    phaseParam = getValue(proc.osc4Params.phase);
+    phaseParam = param(proc.osc4Params.phase);
     b4 = phaseParam - lastp4;
     lastp4 = phaseParam;
 
-    switch (int(proc.filterParams.type->getUserValue()))
-    {
-    case 0:
-        filter.setType(gin::Filter::lowpass);
-        filter.setSlope(gin::Filter::db12);
-        break;
-    case 1:
-        filter.setType(gin::Filter::lowpass);
-        filter.setSlope(gin::Filter::db24);
-        break;
-    case 2:
-        filter.setType(gin::Filter::highpass);
-        filter.setSlope(gin::Filter::db12);
-        break;
-    case 3:
-        filter.setType(gin::Filter::highpass);
-        filter.setSlope(gin::Filter::db24);
-        break;
-    case 4:
-        filter.setType(gin::Filter::bandpass);
-        filter.setSlope(gin::Filter::db12);
-        break;
-    case 5:
-        filter.setType(gin::Filter::bandpass);
-        filter.setSlope(gin::Filter::db24);
-        break;
-    case 6:
-        filter.setType(gin::Filter::notch);
-        filter.setSlope(gin::Filter::db12);
-        break;
-    case 7:
-        filter.setType(gin::Filter::notch);
-        filter.setSlope(gin::Filter::db24);
-        break;
-    }
-
     // filter
-    float noteNum = getValue(proc.filterParams.frequency);
-    noteNum += (currentlyPlayingNote.initialNote - 50) * getValue(proc.filterParams.keyTracking);
-    float f = gin::getMidiNoteInHertz(noteNum);
-    f = juce::jlimit(4.0f, maxFreq, f);
-    float q = gin::Q / (1.0f - (getValue(proc.filterParams.resonance) / 100.0f) * 0.99f);
-
-    // 'f' and 'q' LP-filtered
-    fnz1 = fna0 * noteNum + fnb1 * fnz1;
-    fqz1 = fqa0 * q + fqb1 * fqz1;
-    filter.setParams(juce::jlimit<float>(4.f, maxFreq, gin::getMidiNoteInHertz(fnz1)), fqz1);
-
-    gin::LFO::Parameters params;
-    float freq = 0;
-
-    // lfo 1
-    if (proc.lfo1Params.sync->getUserValue() > 0.0f)
-        freq = 1.0f / gin::NoteDuration::getNoteDurations()[size_t(proc.lfo1Params.beat->getUserValue())].toSeconds(proc.playhead);
-    else
-        freq = getValue(proc.lfo1Params.rate);
-    params.waveShape = (gin::LFO::WaveShape) int(proc.lfo1Params.wave->getUserValue());
-    params.frequency = freq;
-    params.phase = getValue(proc.lfo1Params.phase);
-    params.offset = getValue(proc.lfo1Params.offset);
-    params.depth = getValue(proc.lfo1Params.depth);
-    params.delay = getValue(proc.lfo1Params.delay);
-    params.fade = getValue(proc.lfo1Params.fade);
-    lfo1.setParameters(params);
-    lfo1.process(blockSize);
-    proc.modMatrix.setPolyValue(*this, proc.modSrcLFO1, lfo1.getOutput());
-
-    // lfo 2
-    if (proc.lfo2Params.sync->getUserValue() > 0.0f)
-        freq = 1.0f / gin::NoteDuration::getNoteDurations()[size_t(proc.lfo2Params.beat->getUserValue())].toSeconds(proc.playhead);
-    else
-        freq = getValue(proc.lfo2Params.rate);
-    params.waveShape = (gin::LFO::WaveShape) int(proc.lfo2Params.wave->getUserValue());
-    params.frequency = freq;
-    params.phase = getValue(proc.lfo2Params.phase);
-    params.offset = getValue(proc.lfo2Params.offset);
-    params.depth = getValue(proc.lfo2Params.depth);
-    params.delay = getValue(proc.lfo2Params.delay);
-    params.fade = getValue(proc.lfo2Params.fade);
-    lfo2.setParameters(params);
-    lfo2.process(blockSize);
-    proc.modMatrix.setPolyValue(*this, proc.modSrcLFO2, lfo2.getOutput());
-
-    // lfo 3
-    if (proc.lfo3Params.sync->getUserValue() > 0.0f)
-        freq = 1.0f / gin::NoteDuration::getNoteDurations()[size_t(proc.lfo3Params.beat->getUserValue())].toSeconds(proc.playhead);
-    else
-        freq = getValue(proc.lfo3Params.rate);
-    params.waveShape = (gin::LFO::WaveShape) int(proc.lfo3Params.wave->getUserValue());
-    params.frequency = freq;
-    params.phase = getValue(proc.lfo3Params.phase);
-    params.offset = getValue(proc.lfo3Params.offset);
-    params.depth = getValue(proc.lfo3Params.depth);
-    params.delay = getValue(proc.lfo3Params.delay);
-    params.fade = getValue(proc.lfo3Params.fade);
-    lfo3.setParameters(params);
-    lfo3.process(blockSize);
-    proc.modMatrix.setPolyValue(*this, proc.modSrcLFO3, lfo3.getOutput());
-
-    // lfo 4
-    if (proc.lfo4Params.sync->getUserValue() > 0.0f)
-        freq = 1.0f / gin::NoteDuration::getNoteDurations()[size_t(proc.lfo4Params.beat->getUserValue())].toSeconds(proc.playhead);
-    else
-        freq = getValue(proc.lfo4Params.rate);
-    params.waveShape = (gin::LFO::WaveShape) int(proc.lfo4Params.wave->getUserValue());
-    params.frequency = freq;
-    params.phase = getValue(proc.lfo4Params.phase);
-    params.offset = getValue(proc.lfo4Params.offset);
-    params.depth = getValue(proc.lfo4Params.depth);
-    params.delay = getValue(proc.lfo4Params.delay);
-    params.fade = getValue(proc.lfo4Params.fade);
-    lfo4.setParameters(params);
-    lfo4.process(blockSize);
-    proc.modMatrix.setPolyValue(*this, proc.modSrcLFO4, lfo4.getOutput());
+    float noteNum = param(proc.filterParams.frequency);
+    noteNum += (currentlyPlayingNote.initialNote - 50) * param(proc.filterParams.keyTracking);
+    filterCutoff = juce::jlimit(4.0f, std::min(maxFreq, 0.49f * float(getSampleRate())), gin::getMidiNoteInHertz(noteNum));
+    const float q = gin::Q / (1.0f - (param(proc.filterParams.resonance) / 100.0f) * 0.99f);
+
+    // the coefficients ramp to these until the next tick, in VoiceBank's filter kernels
+    filterG.target = std::tan(juce::MathConstants<float>::pi * filterCutoff / float(getSampleRate()));
+    filterK.target = 1.0f / q;
 
     Envelope::Params p;
-    p.attackTimeMs = getValue(proc.env1Params.attack);
-    p.decayTimeMs = getValue(proc.env1Params.decay);
-    p.sustainLevel = getValue(proc.env1Params.sustain);
-    p.releaseTimeMs = fastKill ? 0.01f : getValue(proc.env1Params.release);
-    p.aCurve = getValue(proc.env1Params.acurve);
-    p.dRCurve = getValue(proc.env1Params.drcurve);
+    p.attackTimeMs = param(proc.env1Params.attack);
+    p.decayTimeMs = param(proc.env1Params.decay);
+    p.sustainLevel = param(proc.env1Params.sustain);
+    p.releaseTimeMs = fastKill ? 0.01f : param(proc.env1Params.release);
+    p.aCurve = param(proc.env1Params.acurve);
+    p.dRCurve = param(proc.env1Params.drcurve);
     int mode = proc.env1Params.syncrepeat->getUserValueInt();
     p.sync = (!(mode == 0));
     p.repeat = (!(mode == 0));
     if (mode == 1)
     {
         p.sync = true;
-        p.syncduration = gin::NoteDuration::getNoteDurations()[size_t(proc.env1Params.duration->getUserValue())].toSeconds(proc.playhead);
+        p.syncduration = proc.transport.noteSeconds(proc.env1Params.duration->getUserValue());
     }
     if (mode == 2)
     {
         p.sync = true;
-        p.syncduration = getValue(proc.env1Params.time);
+        p.syncduration = param(proc.env1Params.time);
     }
     env1.setParameters(p);
 
-    p.attackTimeMs = getValue(proc.env2Params.attack);
-    p.decayTimeMs = getValue(proc.env2Params.decay);
-    p.sustainLevel = getValue(proc.env2Params.sustain);
-    p.releaseTimeMs = fastKill ? 0.01f : getValue(proc.env2Params.release);
-    p.aCurve = getValue(proc.env2Params.acurve);
-    p.dRCurve = getValue(proc.env2Params.drcurve);
+    p.attackTimeMs = param(proc.env2Params.attack);
+    p.decayTimeMs = param(proc.env2Params.decay);
+    p.sustainLevel = param(proc.env2Params.sustain);
+    p.releaseTimeMs = fastKill ? 0.01f : param(proc.env2Params.release);
+    p.aCurve = param(proc.env2Params.acurve);
+    p.dRCurve = param(proc.env2Params.drcurve);
     mode = proc.env2Params.syncrepeat->getUserValueInt();
     p.sync = (mode != 0);
     p.repeat = (mode != 0);
     if (mode == 1)
     {
         p.sync = true;
-        p.syncduration = gin::NoteDuration::getNoteDurations()[size_t(proc.env2Params.duration->getUserValue())].toSeconds(proc.playhead);
+        p.syncduration = proc.transport.noteSeconds(proc.env2Params.duration->getUserValue());
     }
     if (mode == 2)
     {
         p.sync = true;
-        p.syncduration = getValue(proc.env2Params.time);
+        p.syncduration = param(proc.env2Params.time);
     }
     env2.setParameters(p);
 
-    p.attackTimeMs = getValue(proc.env3Params.attack);
-    p.decayTimeMs = getValue(proc.env3Params.decay);
-    p.sustainLevel = getValue(proc.env3Params.sustain);
-    p.releaseTimeMs = fastKill ? 0.01f : getValue(proc.env3Params.release);
-    p.aCurve = getValue(proc.env3Params.acurve);
-    p.dRCurve = getValue(proc.env3Params.drcurve);
+    p.attackTimeMs = param(proc.env3Params.attack);
+    p.decayTimeMs = param(proc.env3Params.decay);
+    p.sustainLevel = param(proc.env3Params.sustain);
+    p.releaseTimeMs = fastKill ? 0.01f : param(proc.env3Params.release);
+    p.aCurve = param(proc.env3Params.acurve);
+    p.dRCurve = param(proc.env3Params.drcurve);
     mode = proc.env3Params.syncrepeat->getUserValueInt();
     p.sync = (!(mode == 0));
     p.repeat = (!(mode == 0));
     if (mode == 1)
     {
         p.sync = true;
-        p.syncduration = gin::NoteDuration::getNoteDurations()[size_t(proc.env3Params.duration->getUserValue())].toSeconds(proc.playhead);
+        p.syncduration = proc.transport.noteSeconds(proc.env3Params.duration->getUserValue());
     }
     if (mode == 2)
     {
         p.sync = true;
-        p.syncduration = getValue(proc.env3Params.time);
+        p.syncduration = param(proc.env3Params.time);
     }
     env3.setParameters(p);
 
-    p.attackTimeMs = getValue(proc.env4Params.attack);
-    p.decayTimeMs = getValue(proc.env4Params.decay);
-    p.sustainLevel = getValue(proc.env4Params.sustain);
-    p.releaseTimeMs = fastKill ? 0.01f : getValue(proc.env4Params.release);
-    p.aCurve = getValue(proc.env4Params.acurve);
-    p.dRCurve = getValue(proc.env4Params.drcurve);
+    p.attackTimeMs = param(proc.env4Params.attack);
+    p.decayTimeMs = param(proc.env4Params.decay);
+    p.sustainLevel = param(proc.env4Params.sustain);
+    p.releaseTimeMs = fastKill ? 0.01f : param(proc.env4Params.release);
+    p.aCurve = param(proc.env4Params.acurve);
+    p.dRCurve = param(proc.env4Params.drcurve);
     mode = proc.env4Params.syncrepeat->getUserValueInt();
     p.sync = (!(mode == 0));
     p.repeat = (!(mode == 0));
     if (mode == 1)
     {
         p.sync = true;
-        p.syncduration = gin::NoteDuration::getNoteDurations()[size_t(proc.env4Params.duration->getUserValue())].toSeconds(proc.playhead);
+        p.syncduration = proc.transport.noteSeconds(proc.env4Params.duration->getUserValue());
     }
     if (mode == 2)
     {
         p.sync = true;
-        p.syncduration = getValue(proc.env4Params.time);
+        p.syncduration = param(proc.env4Params.time);
     }
     env4.setParameters(p);
 
-    proc.modMatrix.setPolyValue(*this, proc.modSrcEnv1, env1.getOutput());
-    proc.modMatrix.setPolyValue(*this, proc.modSrcEnv2, env2.getOutput());
-    proc.modMatrix.setPolyValue(*this, proc.modSrcEnv3, env3.getOutput());
-    proc.modMatrix.setPolyValue(*this, proc.modSrcEnv4, env4.getOutput());
-
     noteSmoother.process(blockSize);
-
-    if (proc.mseg1Params.sync->isOn())
-    {
-        mseg1Params.frequency = 1 / gin::NoteDuration::getNoteDurations()[size_t(getValue(proc.mseg1Params.beat))].toSeconds(proc.playhead);
-    }
-    else
-    {
-        mseg1Params.frequency = getValue(proc.mseg1Params.rate);
-    }
-    mseg1Params.depth = getValue(proc.mseg1Params.depth); // proc.mseg1Params.depth->getUserValue();
-    mseg1Params.offset = getValue(proc.mseg1Params.offset);
-    mseg1Params.loop = proc.mseg1Params.loop->isOn();
-
-    if (proc.mseg2Params.sync->isOn())
-    {
-        mseg2Params.frequency = 1 / gin::NoteDuration::getNoteDurations()[size_t(getValue(proc.mseg2Params.beat))].toSeconds(proc.playhead);
-    }
-    else
-    {
-        mseg2Params.frequency = getValue(proc.mseg2Params.rate);
-    }
-    mseg2Params.depth = getValue(proc.mseg2Params.depth);
-    mseg2Params.offset = getValue(proc.mseg2Params.offset);
-    mseg2Params.loop = proc.mseg2Params.loop->isOn();
-
-    if (proc.mseg3Params.sync->isOn())
-    {
-        mseg3Params.frequency = 1 / gin::NoteDuration::getNoteDurations()[size_t(getValue(proc.mseg3Params.beat))].toSeconds(proc.playhead);
-    }
-    else
-    {
-        mseg3Params.frequency = getValue(proc.mseg3Params.rate);
-    }
-    mseg3Params.depth = getValue(proc.mseg3Params.depth); // proc.mseg3Params.depth->getUserValue();
-    mseg3Params.offset = getValue(proc.mseg3Params.offset);
-    mseg3Params.loop = proc.mseg3Params.loop->isOn();
-
-    if (proc.mseg4Params.sync->isOn())
-    {
-        mseg4Params.frequency = 1 / gin::NoteDuration::getNoteDurations()[size_t(getValue(proc.mseg4Params.beat))].toSeconds(proc.playhead);
-    }
-    else
-    {
-        mseg4Params.frequency = getValue(proc.mseg4Params.rate);
-    }
-    mseg4Params.depth = getValue(proc.mseg4Params.depth);
-    mseg4Params.offset = getValue(proc.mseg4Params.offset);
-    mseg4Params.loop = proc.mseg4Params.loop->isOn();
-
-    mseg1.setParameters(mseg1Params);
-    mseg2.setParameters(mseg2Params);
-    mseg3.setParameters(mseg3Params);
-    mseg4.setParameters(mseg4Params);
-
-    mseg1.process(blockSize);
-    mseg2.process(blockSize);
-    mseg3.process(blockSize);
-    mseg4.process(blockSize);
-
-    proc.modMatrix.setPolyValue(*this, proc.modSrcMSEG1, mseg1.getOutput());
-    proc.modMatrix.setPolyValue(*this, proc.modSrcMSEG2, mseg2.getOutput());
-    proc.modMatrix.setPolyValue(*this, proc.modSrcMSEG3, mseg3.getOutput());
-    proc.modMatrix.setPolyValue(*this, proc.modSrcMSEG4, mseg4.getOutput());
 }
 
+// the poly LFOs live in ModulatorBank, one lane per voice
+float PMVoice::getLFO1Phase() const { return proc.modulators.getLFOPhase(0, voiceIndex); }
+float PMVoice::getLFO2Phase() const { return proc.modulators.getLFOPhase(1, voiceIndex); }
+float PMVoice::getLFO3Phase() const { return proc.modulators.getLFOPhase(2, voiceIndex); }
+float PMVoice::getLFO4Phase() const { return proc.modulators.getLFOPhase(3, voiceIndex); }
+
 float PMVoice::getFilterCutoffNormalized() const
 {
-    const float freq = filter.getFrequency();
     const auto range = proc.filterParams.frequency->getUserRange();
-    return range.convertTo0to1(juce::jlimit(range.start, range.end, gin::getMidiNoteFromHertz(freq)));
+    return range.convertTo0to1(juce::jlimit(range.start, range.end, gin::getMidiNoteFromHertz(filterCutoff)));
 }
 
 gin::Wave PMVoice::waveForChoice(const int choice)
@@ -18,7 +18,6 @@
 #include <gin_plugin/gin_plugin.h>
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <numbers>
-#include <random>
 #include "Envelope.h"
 #include "MTS-ESP/libMTSClient.h"
 class PMProcessor;
@@ -37,7 +36,7 @@ class PMVoice final : public gin::SynthesiserVoice, public gin::ModVoice
 
     void notePressureChanged() override;
     void noteTimbreChanged() override;
-    void notePitchbendChanged() override {}
+    void notePitchbendChanged() override;
     void noteKeyStateChanged() override {}
 
     void setCurrentSampleRate(double newRate) override;
@@ -53,10 +52,10 @@ class PMVoice final : public gin::SynthesiserVoice, public gin::ModVoice
     [[nodiscard]] inline float getMSEG2Phase() const { return mseg2.getCurrentPhase(); }
     [[nodiscard]] inline float getMSEG3Phase() const { return mseg3.getCurrentPhase(); }
     [[nodiscard]] inline float getMSEG4Phase() const { return mseg4.getCurrentPhase(); }
-    inline float getLFO1Phase() { return lfo1.getCurrentPhase(); }
-    inline float getLFO2Phase() { return lfo2.getCurrentPhase(); }
-    inline float getLFO3Phase() { return lfo3.getCurrentPhase(); }
-    inline float getLFO4Phase() { return lfo4.getCurrentPhase(); }
+    [[nodiscard]] float getLFO1Phase() const;
+    [[nodiscard]] float getLFO2Phase() const;
+    [[nodiscard]] float getLFO3Phase() const;
+    [[nodiscard]] float getLFO4Phase() const;
     [[nodiscard]] inline Envelope::EnvelopeState getENV1State() const { return env1.getState(); }
     [[nodiscard]] inline Envelope::EnvelopeState getENV2State() const { return env2.getState(); }
     [[nodiscard]] inline Envelope::EnvelopeState getENV3State() const { return env3.getState(); }
@@ -64,59 +63,117 @@ class PMVoice final : public gin::SynthesiserVoice, public gin::ModVoice
 
     gin::Wave waveForChoice(const int choice);
 
-    struct Averager
+    static constexpr int numAlgorithms = 11;
+
+    // operator graph per algorithm: which operators reach the output, and
+    // which operators each one modulates (bit n == osc n + 1)
+    static constexpr std::array<int, numAlgorithms> carriers{0b0001, 0b0001, 0b0001, 0b0001, 0b0011, 0b0011,
+                                                             0b0001, 0b0101, 0b0111, 0b0111, 0b1111};
+    static constexpr std::array<std::array<int, 4>, numAlgorithms> targets{{{0, 0b0001, 0b0010, 0b0100},
+                                                                            {0, 0b0001, 0b0010, 0b0010},
+                                                                            {0, 0b0001, 0b0010, 0b0001},
+                                                                            {0, 0b0001, 0b0001, 0b0110},
+                                                                            {0, 0, 0b0011, 0b0100},
+                                                                            {0, 0, 0b0010, 0b0100},
+                                                                            {0, 0b0001, 0b0001, 0b0001},
+                                                                            {0, 0b0001, 0, 0b0100},
+                                                                            {0, 0, 0, 0b0111},
+                                                                            {0, 0, 0, 0b0100},
+                                                                            {0, 0, 0, 0}}};
+
+    // phase in cycles -> fixed-point phase; out-of-range and negative values wrap around
+    static inline uint32_t toPhase(const double p) { return static_cast<uint32_t>(static_cast<int64_t>(p * 4294967296.0)); }
+
+    // these run per voice as plain floats, or across voices as VoiceBank::Lanes
+    template <typename T> struct Averager
     {
-        static float in;
-        float previous{0};
-        inline float p(float x) { return previous = (x * in + previous * (1.0f - in)); }
+        T in{0.f}, previous{0.f};
+        inline T p(T x) { return previous = (x * in + previous * (T(1.0f) - in)); }
+
+        void load(size_t lane, const Averager<float> &a, bool used)
+        {
+            in.set(lane, a.in);
+            previous.set(lane, used ? a.previous : 0.f);
+        }
+        void store(size_t lane, Averager<float> &a) const { a.previous = previous.get(lane); }
     };
 
-    struct Dezip
+    // a control value, ramped linearly to its target over the control period
+    struct Ramp
     {
-        float p1{0}, p2{0}, p3{0}, p4{0}, p5{0};
-        inline float p(float x)
+        float target{0.f}, current{0.f}; // current is where the block ends
+        float start{0.f}, step{0.f};     // the block being rendered
+        inline void advance(const int samplesLeft, const int numSamples)
+        {
+            start = current;
+            step = (target - current) / static_cast<float>(std::max(samplesLeft, numSamples));
+            current += step * static_cast<float>(numSamples);
+        }
+        inline void snap()
         {
-            p5 = p4;
-            p4 = p3;
-            p3 = p2;
-            p2 = p1;
-            p1 = x;
-            return (p1 + p2 + p3 + p4 + p5) * 0.2f;
+            start = current = target;
+            step = 0.f;
         }
     };
 
-    [[nodiscard]] inline float w(gin::Wave sel, float phase, float freq, bool isMod);
-
   private:
     void updateParams(int blockSize);
+    void updateModulators(int blockSize);
+    void updateSources();
+    void updateSettings();
+    void updatePitch();
+    void setControlRate();
+    float param(gin::Parameter *p);
+
+    // the operators themselves are rendered by VoiceBank, several voices at a time
+    void startRender(int numSamples, bool controlTick);
+    void renderEnvelopes(float *scratch, int scratchSize, float *dest, int stride, int opStride, int numSamples);
+    // synthBuffer holds this voice's (mono) operator output, and is scratch space shared by all voices
+    void finishRender(juce::AudioBuffer<float> &synthBuffer, juce::AudioBuffer<float> &outputBuffer, int startSample, int numSamples);
+    void applyPendingStop();
+    void advanceRamps(int numSamples);
+    void snapRamps();
+    void updateOpMask();
+    [[nodiscard]] bool carriersSilent() const;
 
     PMProcessor &proc;
-    gin::BandLimitedLookupTables &bllt;
 
-    gin::Filter filter;
-    gin::LFO lfo1, lfo2, lfo3, lfo4;
     gin::MSEG mseg1, mseg2, mseg3, mseg4;
     gin::MSEG::Parameters mseg1Params, mseg2Params, mseg3Params, mseg4Params;
+    std::array<gin::MSEG *, 4> msegs{&mseg1, &mseg2, &mseg3, &mseg4};
+    std::array<gin::MSEG::Parameters *, 4> msegParams{&mseg1Params, &mseg2Params, &mseg3Params, &mseg4Params};
     Envelope env1, env2, env3, env4;
     std::array<Envelope *, 4> envs{&env1, &env2, &env3, &env4};
     std::array<Envelope *, 4> envsByNum{&env1, &env2, &env3, &env4};
 
-    int filterType{0};
-    double freq1 = 0.0, freq2 = 0.0, freq3 = 0.0, freq4 = 0.0;
-    double freq4factor = 1.0f, freq3factor = 1.0f, freq2factor = 1.0f;
+    uint32_t seenVersion{0}; // ParamSnapshot::version last seen by updateSettings()
+    std::array<float, 4> freqs{};     // operator frequencies in Hz, ramped to per sample
+    std::array<float, 4> opTuning{};  // coarse + fine: a ratio, or hundreds of Hz when fixed
+    std::array<bool, 4> opFixed{};
+    float pitchScale{1.f};            // the Pitch parameter, as a ratio
     float vol1 = 0.0f, vol2 = 0.0f, vol3 = 0.0f, vol4 = 0.0f;
-    double phase1 = 0.0, phase2 = 0.0, phase3 = 0.0, phase4 = 0.0;
+    uint32_t phase1 = 0, phase2 = 0, phase3 = 0, phase4 = 0; // one cycle == 2^32, so wrapping is free
     double b1{0}, b2{0}, b3{0}, b4{0}; // phase bumps
     // double phase = 0.0;
 
     gin::Wave w1, w2, w3, w4;
-    Averager a4, a3, a2;
-    Dezip v4, v3, v2, v1;
+    Averager<float> a4, a3, a2;
+    std::array<Ramp, 4> volRamps; // vol1 .. vol4
+    std::array<Ramp, 4> freqRamps;
+    Ramp modIndexRamp;
+    Ramp filterG, filterK; // state-variable filter cutoff (as tan(pi f / sr)) and damping (1 / q)
+    std::array<float, 4> filterState{}; // the integrators of both filter stages, run by VoiceBank
+    float filterCutoff{20000.f};        // Hz, for display
+    int rampLeft{0}; // samples until the ramps reach their targets
     int algo{0};
+    int opMask{0b1111};    // operators that are sounding and reach the output
+    bool filterIdle{true}; // filter has rung out on silent input
+    bool stopPending{false}; // set while rendering, acted on by the audio thread
     float modIndex{4.f};
     float lastp1{0.f}, lastp2{0.f}, lastp3{0.f}, lastp4{0.f}; // last phase
 
-    int tilUpdate{0}; // only update envelopes/lfo/mseg every 4th block
+    int controlDivisor{4}; // control ticks come every nth block, from the Mod Resolution setting
+    int voiceIndex{-1};    // this voice's slot in MidiDispatch and ModRouting
 
     float currentMidiNote = -1;
 
@@ -124,17 +181,17 @@ class PMVoice final : public gin::SynthesiserVoice, public gin::ModVoice
 
     gin::EasedValueSmoother<float> noteSmoother;
 
-    double fna0, fnb1, fnz1, fqa0, fqb1, fqz1; //
-
-    juce::AudioBuffer<float> synthBuffer;
-
     float antipop{0.f};
+    float spreadPos{0.f};                  // where this note sits within the stereo spread, -1 to 1
+    float lastGainL{-1.f}, lastGainR{-1.f}; // pan gains of the last block, ramped from
 
     friend class PMSynth;
+    friend class VoiceBank;
+    friend class RenderPool;
+    friend class ModulatorBank;
+    friend class MidiDispatch;
+    friend class ModRouting;
     juce::MPENote curNote;
 
-    std::random_device rd;
-    std::mt19937 gen{rd()};
-    std::uniform_real_distribution<> dist{-1.f, 1.f};
     const float maxFreq{20000.f};
 };
@@ -0,0 +1,182 @@
+/*
+ * PM Daze - an expressive, semi-modular, phase-modulation synthesizer
+ *
+ * Copyright 2025, Greg Recco
+ *
+ * PM Daze is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source code for PM Daze is available at
+ * https://github.com/gregrecco67/PMDaze
+ */
+
+#pragma once
+
+#include <gin_plugin/gin_plugin.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+//==============================================================================
+// The value of every modulatable parameter, laid out flat by mod index and
+// refreshed once per block, so voices only go through the mod matrix for
+// parameters that are actually modulated. 'version' changes whenever any
+// parameter or the mod routing changes, which lets voices skip work that
+// only depends on unmodulated settings.
+//
+// A new value isn't jumped to: like the mod matrix's own smoothers, the
+// snapshot moves towards it at full scale per 20 ms, in normalised units,
+// one synth block at a time. Stepped parameters jump.
+class ParamSnapshot
+{
+  public:
+    // after the mod matrix is built
+    void setup(const juce::Array<gin::Parameter *> &params)
+    {
+        all.assign(params.begin(), params.end());
+        userValues.assign(all.size(), std::numeric_limits<float>::quiet_NaN());
+
+        size_t numModParams = 0;
+        for (const auto *p : all)
+            numModParams = std::max(numModParams, size_t(p->getModIndex() + 1));
+        lines.assign((numModParams + Line::size - 1) / Line::size, {});
+
+        ramps.assign(numModParams, {});
+        for (auto *p : all)
+            if (p->getModIndex() >= 0)
+                ramps[size_t(p->getModIndex())].param = p;
+        ramping.clear();
+        ramping.reserve(numModParams);
+        changedParams.clear();
+        changedParams.reserve(all.size());
+    }
+
+    // host rate
+    void setSampleRate(const double sampleRate) { slope = float(1.0 / (sampleRate * smoothingTime)); }
+
+    // audio thread, before the voices run
+    void update(gin::ModMatrix &modMatrix)
+    {
+        bool changed = false;
+        changedParams.clear();
+        for (size_t i = 0; i < all.size(); i++)
+        {
+            auto *p = all[i];
+            const float v = p->getUserValue();
+            const bool valueChanged = !(v == userValues[i]); // true the first time, against NaN
+            const bool first = std::isnan(userValues[i]);
+            userValues[i] = v;
+            if (valueChanged)
+                changedParams.push_back(p);
+
+            const int idx = p->getModIndex();
+            if (idx < 0)
+            {
+                changed |= valueChanged;
+                continue;
+            }
+
+            auto &e = entry(idx);
+            if (valueChanged)
+                startRamp(idx, first || p->getUserRange().interval > 0.0f);
+            const bool modulated = modMatrix.isModulated(gin::ModDstId(idx));
+            changed |= valueChanged || modulated != e.modulated;
+            e.modulated = modulated;
+        }
+        if (changed)
+            version++;
+    }
+
+    // audio thread, after each synth block: values still easing towards a change move 'numSamples' further
+    void advance(const int numSamples)
+    {
+        const float step = slope * float(numSamples);
+        for (size_t i = 0; i < ramping.size();)
+        {
+            const int idx = ramping[i];
+            auto &r = ramps[size_t(idx)];
+            r.current = r.target > r.current ? std::min(r.current + step, r.target) : std::max(r.current - step, r.target);
+            auto &e = entry(idx);
+            e.value = toUser(r.param, r.current);
+            if (r.current == r.target)
+            {
+                e.ramping = false;
+                ramping[i] = ramping.back();
+                ramping.pop_back();
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+
+    [[nodiscard]] inline bool isModulated(const gin::Parameter *p) const { return entry(p->getModIndex()).modulated; }
+    [[nodiscard]] inline float value(const gin::Parameter *p) const { return entry(p->getModIndex()).value; }
+    [[nodiscard]] inline bool isRamping(const gin::Parameter *p) const { return entry(p->getModIndex()).ramping; }
+    // the parameters whose value changed at the last update(), usually none
+    [[nodiscard]] inline const std::vector<gin::Parameter *> &getChanged() const { return changedParams; }
+
+    uint32_t version{0};
+
+  private:
+    struct Entry
+    {
+        float value{0.f}; // smoothed
+        bool modulated{true}, ramping{false};
+    };
+    struct Ramp
+    {
+        gin::Parameter *param{nullptr};
+        float current{0.f}, target{0.f}; // normalised
+    };
+
+    static constexpr double smoothingTime = 0.02; // seconds, for full scale
+
+    static float toUser(const gin::Parameter *p, const float normalised)
+    {
+        const float v = p->getUserRange().convertFrom0to1(normalised);
+        return p->conversionFunction ? p->conversionFunction(v) : v;
+    }
+
+    void startRamp(const int idx, const bool jump)
+    {
+        auto &r = ramps[size_t(idx)];
+        auto &e = entry(idx);
+        r.target = r.param->getValue();
+        if (jump)
+            r.current = r.target;
+        if (r.current == r.target)
+        {
+            e.value = toUser(r.param, r.current);
+            return;
+        }
+        if (!e.ramping)
+            ramping.push_back(idx);
+        e.ramping = true;
+    }
+    struct alignas(64) Line
+    {
+        static constexpr int size = 64 / sizeof(Entry);
+        std::array<Entry, size> entries;
+    };
+
+    inline Entry &entry(const int idx) { return lines[size_t(idx / Line::size)].entries[size_t(idx % Line::size)]; }
+    [[nodiscard]] inline const Entry &entry(const int idx) const
+    {
+        jassert(idx >= 0);
+        return lines[size_t(idx / Line::size)].entries[size_t(idx % Line::size)];
+    }
+
+    std::vector<Line> lines; // one cache line each
+    std::vector<gin::Parameter *> all;
+    std::vector<float> userValues;
+    std::vector<Ramp> ramps;  // by mod index
+    std::vector<int> ramping; // mod indices still easing
+    std::vector<gin::Parameter *> changedParams;
+    float slope{0.f};         // normalised change per host sample
+};
@@ -0,0 +1,156 @@
+/*
+ * PM Daze - an expressive, semi-modular, phase-modulation synthesizer
+ *
+ * Copyright 2025, Greg Recco
+ *
+ * PM Daze is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source code for PM Daze is available at
+ * https://github.com/gregrecco67/PMDaze
+ */
+
+#pragma once
+
+#include "PolyphaseStereo.h"
+
+// The allpass chain, written once over a register type. Each instruction set's
+// translation unit includes this with its own Isa, which provides
+//   V, groups                 the register type, and how many four-lane groups it holds
+//   load, mul                 an unaligned load of a whole register, lane-wise multiply
+//   fma(a, b, c)              a * b + c
+//   broadcast(p)              four floats into every group
+//   top(v, p)                 stores the top group
+//   shiftIn(prev, v)          v moved up a group, with the top group of prev in group 0
+//   shiftUp<n>(v)             v moved up n groups, with zeros below
+//   broadcastTop(v)           the top group of v in every group
+//   loadDown, storeDown       a step's samples in and out of group layout, for a downsampler
+//   loadUp, storeUp           and for an upsampler
+// and is compiled with the flags that instruction set needs.
+//
+// Each stage is y[n] = c * (x[n] - y[n - 1]) + x[n - 1]. A step works out
+// 'groups' samples of it at once: first the part that only depends on the
+// input, u[n] = c * x[n] + x[n - 1], folded along the register by a prefix
+// sum in powers of -c, and then (-c)^(j + 1) * y[n - 1] added to the j-th
+// sample. Only that last multiply-add waits on the previous step.
+namespace polyphase
+{
+template <class Isa, int K, bool Down> void run(State &st, float *outL, float *outR, const float *inL, const float *inR, const int numSamples)
+{
+    using V = typename Isa::V;
+    constexpr int G = Isa::groups;
+
+    V c[K], negC[K], cc[K], powers[K], xs[K], ys[K];
+    for (int s = 0; s < K; s++)
+    {
+        float p[G * 4]; // (-c)^(g + 1) in group g
+        for (int l = 0; l < 4; l++)
+        {
+            float power = 1.0f;
+            for (int g = 0; g < G; g++)
+                p[g * 4 + l] = power *= -st.coef[s][l];
+        }
+        c[s] = Isa::broadcast(st.coef[s]);
+        negC[s] = Isa::broadcast(p);
+        cc[s] = Isa::mul(c[s], c[s]);
+        powers[s] = Isa::load(p);
+        xs[s] = Isa::broadcast(st.x[s]);
+        ys[s] = Isa::broadcast(st.y[s]);
+    }
+
+    const int numSteps = numSamples / G;
+    for (int i = 0; i < numSteps; i++)
+    {
+        const int n = i * G;
+        auto x = Down ? Isa::loadDown(inL + 2 * n, inR + 2 * n) : Isa::loadUp(inL + n, inR + n);
+        for (int s = 0; s < K; s++)
+        {
+            auto u = Isa::fma(c[s], x, Isa::shiftIn(xs[s], x));
+            if constexpr (G >= 2)
+                u = Isa::fma(negC[s], Isa::template shiftUp<1>(u), u);
+            if constexpr (G >= 4)
+                u = Isa::fma(cc[s], Isa::template shiftUp<2>(u), u);
+            xs[s] = x;
+            x = ys[s] = Isa::fma(powers[s], Isa::broadcastTop(ys[s]), u);
+        }
+
+        if constexpr (Down)
+            Isa::storeDown(outL + n, outR + n, x);
+        else
+            Isa::storeUp(outL + 2 * n, outR + 2 * n, x);
+    }
+
+    for (int s = 0; s < K; s++)
+    {
+        Isa::top(xs[s], st.x[s]);
+        Isa::top(ys[s], st.y[s]);
+    }
+
+    // what's left over, a sample at a time
+    for (int n = numSteps * G; n < numSamples; n++)
+    {
+        float x[4];
+        if constexpr (Down)
+            x[0] = inL[2 * n], x[1] = inL[2 * n + 1], x[2] = inR[2 * n], x[3] = inR[2 * n + 1];
+        else
+            x[0] = x[1] = inL[n], x[2] = x[3] = inR[n];
+
+        for (int s = 0; s < K; s++)
+        {
+            for (int l = 0; l < 4; l++)
+            {
+                const float y = st.coef[s][l] * (x[l] - st.y[s][l]) + st.x[s][l];
+                st.x[s][l] = x[l];
+                st.y[s][l] = x[l] = y;
+            }
+        }
+
+        if constexpr (Down)
+        {
+            outL[n] = 0.5f * (x[0] + x[1]);
+            outR[n] = 0.5f * (x[2] + x[3]);
+        }
+        else
+        {
+            outL[2 * n] = x[1], outL[2 * n + 1] = x[0];
+            outR[2 * n] = x[3], outR[2 * n + 1] = x[2];
+        }
+    }
+}
+
+template <class Isa, bool Down> void run(State &st, float *outL, float *outR, const float *inL, const float *inR, const int numSamples)
+{
+    switch (st.stages)
+    {
+    case 1:
+        return run<Isa, 1, Down>(st, outL, outR, inL, inR, numSamples);
+    case 2:
+        return run<Isa, 2, Down>(st, outL, outR, inL, inR, numSamples);
+    case 3:
+        return run<Isa, 3, Down>(st, outL, outR, inL, inR, numSamples);
+    case 4:
+        return run<Isa, 4, Down>(st, outL, outR, inL, inR, numSamples);
+    case 5:
+        return run<Isa, 5, Down>(st, outL, outR, inL, inR, numSamples);
+    case 6:
+        return run<Isa, 6, Down>(st, outL, outR, inL, inR, numSamples);
+    case 7:
+        return run<Isa, 7, Down>(st, outL, outR, inL, inR, numSamples);
+    default:
+        return run<Isa, State::maxStages, Down>(st, outL, outR, inL, inR, numSamples);
+    }
+}
+
+// a downsampler reads in[2n] and in[2n + 1] and writes out[n]; an upsampler reads in[n] and writes out[2n] and out[2n + 1]
+template <class Isa> void downsample(State &st, float *outL, float *outR, const float *inL, const float *inR, const int numOut)
+{
+    run<Isa, true>(st, outL, outR, inL, inR, numOut);
+}
+
+template <class Isa> void upsample(State &st, float *outL, float *outR, const float *inL, const float *inR, const int numIn)
+{
+    run<Isa, false>(st, outL, outR, inL, inR, numIn);
+}
+} // namespace polyphase
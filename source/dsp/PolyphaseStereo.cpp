@@ -0,0 +1,152 @@
+#include "PolyphaseStereo.h"
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include "PolyphaseKernels.h"
+
+#if USE_SSE
+#include <xmmintrin.h>
+#endif
+#if USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace polyphase
+{
+namespace
+{
+// one group: a sample per step
+#if USE_SSE
+struct Isa4
+{
+    using V = __m128;
+    static constexpr int groups = 1;
+    static V load(const float *p) { return _mm_loadu_ps(p); }
+    static V mul(const V a, const V b) { return _mm_mul_ps(a, b); }
+    static V fma(const V a, const V b, const V c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static V broadcast(const float *p) { return _mm_loadu_ps(p); }
+    static void top(const V v, float *p) { _mm_storeu_ps(p, v); }
+    static V shiftIn(const V prev, V) { return prev; }
+    template <int> static V shiftUp(const V v) { return v; }
+    static V broadcastTop(const V v) { return v; }
+
+    static V loadDown(const float *l, const float *r)
+    {
+        return _mm_castpd_ps(_mm_unpacklo_pd(_mm_load_sd(reinterpret_cast<const double *>(l)), _mm_load_sd(reinterpret_cast<const double *>(r))));
+    }
+    static void storeDown(float *l, float *r, const V v)
+    {
+        const auto sums = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        _mm_store_ss(l, _mm_mul_ss(sums, _mm_set_ss(0.5f)));
+        _mm_store_ss(r, _mm_mul_ss(_mm_movehl_ps(sums, sums), _mm_set_ss(0.5f)));
+    }
+    static V loadUp(const float *l, const float *r) { return _mm_setr_ps(*l, *l, *r, *r); }
+    static void storeUp(float *l, float *r, const V v)
+    {
+        const auto swapped = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storel_pi(reinterpret_cast<__m64 *>(l), swapped);
+        _mm_storeh_pi(reinterpret_cast<__m64 *>(r), swapped);
+    }
+};
+#endif
+#if USE_NEON
+struct Isa4
+{
+    using V = float32x4_t;
+    static constexpr int groups = 1;
+    static V load(const float *p) { return vld1q_f32(p); }
+    static V mul(const V a, const V b) { return vmulq_f32(a, b); }
+    static V fma(const V a, const V b, const V c) { return vfmaq_f32(c, a, b); }
+    static V broadcast(const float *p) { return vld1q_f32(p); }
+    static void top(const V v, float *p) { vst1q_f32(p, v); }
+    static V shiftIn(const V prev, V) { return prev; }
+    template <int> static V shiftUp(const V v) { return v; }
+    static V broadcastTop(const V v) { return v; }
+
+    static V loadDown(const float *l, const float *r) { return vcombine_f32(vld1_f32(l), vld1_f32(r)); }
+    static void storeDown(float *l, float *r, const V v)
+    {
+        const auto sums = vmulq_n_f32(vaddq_f32(vrev64q_f32(v), v), 0.5f);
+        *l = vgetq_lane_f32(sums, 0);
+        *r = vgetq_lane_f32(sums, 2);
+    }
+    static V loadUp(const float *l, const float *r) { return vcombine_f32(vld1_dup_f32(l), vld1_dup_f32(r)); }
+    static void storeUp(float *l, float *r, const V v)
+    {
+        const auto swapped = vrev64q_f32(v);
+        vst1_f32(l, vget_low_f32(swapped));
+        vst1_f32(r, vget_high_f32(swapped));
+    }
+};
+#endif
+} // namespace
+
+void downsample4(State &st, float *outL, float *outR, const float *inL, const float *inR, const int numOut)
+{
+    downsample<Isa4>(st, outL, outR, inL, inR, numOut);
+}
+
+void upsample4(State &st, float *outL, float *outR, const float *inL, const float *inR, const int numIn)
+{
+    upsample<Isa4>(st, outL, outR, inL, inR, numIn);
+}
+
+int maxGroups()
+{
+#if USE_SSE
+    using juce::SystemStats;
+    static const int groups = SystemStats::hasAVX512F() ? 4 : SystemStats::hasAVX2() && SystemStats::hasFMA3() ? 2 : 1;
+    return groups;
+#else
+    return 1;
+#endif
+}
+} // namespace polyphase
+
+//==============================================================================
+void PolyphaseStereo::setCoefs(const double *coefs, const int numCoefs)
+{
+    using polyphase::State;
+    jassert(numCoefs > 0 && numCoefs <= 2 * State::maxStages);
+
+    // path 0 takes a0, a2, a4 ..., path 1 a1, a3, a5 ...
+    state.stages = (numCoefs + 1) / 2;
+    for (int s = 0; s < state.stages; s++)
+    {
+        for (int lane = 0; lane < 4; lane++)
+        {
+            const int i = lane & 1 ? 2 * s : 2 * s + 1;
+            // a coefficient of 1 passes the signal straight through, padding out the shorter path
+            state.coef[s][lane] = i < numCoefs ? static_cast<float>(coefs[i]) : 1.0f;
+        }
+    }
+
+    // each stage delays DC by (1 - a) / (1 + a) steps; the paths average, give or take the half sample between them
+    double pathDelays[2]{};
+    for (int i = 0; i < numCoefs; i++)
+        pathDelays[i & 1] += (1.0 - coefs[i]) / (1.0 + coefs[i]);
+    delay = (pathDelays[0] + pathDelays[1] + halfStep) * 0.5;
+
+    const int groups = polyphase::maxGroups();
+    kernel = kernels[groups == 4 ? 2 : size_t(groups - 1)];
+    clear();
+}
+
+void PolyphaseStereo::clear()
+{
+    for (int s = 0; s < polyphase::State::maxStages; s++)
+    {
+        std::fill(std::begin(state.x[s]), std::end(state.x[s]), 0.0f);
+        std::fill(std::begin(state.y[s]), std::end(state.y[s]), 0.0f);
+    }
+}
+
+#if USE_SSE
+StereoDownsampler2x::StereoDownsampler2x()
+    : PolyphaseStereo(polyphase::downsample4, polyphase::downsampleAvx2, polyphase::downsampleAvx512, -0.5)
+{
+}
+StereoUpsampler2x::StereoUpsampler2x() : PolyphaseStereo(polyphase::upsample4, polyphase::upsampleAvx2, polyphase::upsampleAvx512, 0.5) {}
+#else
+StereoDownsampler2x::StereoDownsampler2x() : PolyphaseStereo(polyphase::downsample4, nullptr, nullptr, -0.5) {}
+StereoUpsampler2x::StereoUpsampler2x() : PolyphaseStereo(polyphase::upsample4, nullptr, nullptr, 0.5) {}
+#endif
@@ -0,0 +1,109 @@
+/*
+ * PM Daze - an expressive, semi-modular, phase-modulation synthesizer
+ *
+ * Copyright 2025, Greg Recco
+ *
+ * PM Daze is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source code for PM Daze is available at
+ * https://github.com/gregrecco67/PMDaze
+ */
+
+#pragma once
+
+#include <array>
+
+//==============================================================================
+// hiir's 2x polyphase IIR half-band filters, run on a stereo pair at once.
+//
+// A 2x filter is two chains of first-order allpass stages, one per polyphase
+// path. hiir's SSE and NEON classes run one channel with a path per lane, so
+// half of each register sits idle and the two channels run one after the
+// other. Here a group of four lanes holds both paths of both channels:
+// [L path 1, L path 0, R path 1, R path 0].
+//
+// Each stage feeds back its own previous output, so however wide the register,
+// a plain loop waits on one stage's multiply-add chain per sample. With AVX2 or
+// AVX-512 the register holds two or four groups, and each step works out that
+// many consecutive samples, with only one multiply-add per stage waiting on
+// the step before (see PolyphaseKernels.h). The output is the same as hiir's,
+// up to rounding, with no added delay.
+//
+// The widest kernel the CPU supports is picked when the coefficients are set.
+namespace polyphase
+{
+struct State
+{
+    static constexpr int maxStages = 8;
+
+    float coef[maxStages][4]{};                 // per lane of a group
+    float x[maxStages][4]{}, y[maxStages][4]{}; // each stage's last input and output
+    int stages{1};
+};
+
+// 'in' and 'out' are per channel, 'numSamples' counts the lower rate's samples
+using Kernel = void (*)(State &, float *outL, float *outR, const float *inL, const float *inR, int numSamples);
+
+void downsample4(State &, float *, float *, const float *, const float *, int);
+void upsample4(State &, float *, float *, const float *, const float *, int);
+#if USE_SSE
+void downsampleAvx2(State &, float *, float *, const float *, const float *, int);
+void upsampleAvx2(State &, float *, float *, const float *, const float *, int);
+void downsampleAvx512(State &, float *, float *, const float *, const float *, int);
+void upsampleAvx512(State &, float *, float *, const float *, const float *, int);
+#endif
+
+// the number of four-lane groups the CPU can run at once: 1, 2 (AVX2) or 4 (AVX-512)
+int maxGroups();
+} // namespace polyphase
+
+//==============================================================================
+class PolyphaseStereo
+{
+  public:
+    // coefficients from hiir::PolyphaseIir2Designer, at most 2 * State::maxStages of them
+    void setCoefs(const double *coefs, int numCoefs);
+    void clear();
+
+    // the delay at DC, in samples at the lower rate
+    [[nodiscard]] double getDelay() const { return delay; }
+
+  protected:
+    // 'step' is where the two paths' outputs sit relative to each other, -0.5 down and +0.5 up
+    PolyphaseStereo(polyphase::Kernel k4, polyphase::Kernel k8, polyphase::Kernel k16, const double step)
+        : kernels{k4, k8, k16}, kernel(k4), halfStep(step)
+    {
+    }
+
+    polyphase::State state;
+    std::array<polyphase::Kernel, 3> kernels; // by group count 1, 2, 4
+    polyphase::Kernel kernel;
+    double halfStep, delay{0.0};
+};
+
+class StereoDownsampler2x : public PolyphaseStereo
+{
+  public:
+    StereoDownsampler2x();
+
+    // 'in' holds numOut * 2 samples per channel; may be the same buffers as 'out'
+    void process(float *outL, float *outR, const float *inL, const float *inR, const int numOut)
+    {
+        kernel(state, outL, outR, inL, inR, numOut);
+    }
+};
+
+class StereoUpsampler2x : public PolyphaseStereo
+{
+  public:
+    StereoUpsampler2x();
+
+    // 'out' has room for numIn * 2 samples per channel, and mustn't overlap 'in'
+    void process(float *outL, float *outR, const float *inL, const float *inR, const int numIn)
+    {
+        kernel(state, outL, outR, inL, inR, numIn);
+    }
+};
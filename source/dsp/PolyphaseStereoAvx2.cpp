@@ -0,0 +1,62 @@
+// Built with AVX2 and FMA enabled (see CMakeLists.txt); only called when the CPU has it.
+#include "PolyphaseKernels.h"
+
+#if USE_SSE
+#include <immintrin.h>
+
+namespace polyphase
+{
+namespace
+{
+// two groups: two samples per step
+struct Isa8
+{
+    using V = __m256;
+    static constexpr int groups = 2;
+    static V load(const float *p) { return _mm256_loadu_ps(p); }
+    static V mul(const V a, const V b) { return _mm256_mul_ps(a, b); }
+    static V fma(const V a, const V b, const V c) { return _mm256_fmadd_ps(a, b, c); }
+    static V broadcast(const float *p) { return _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(p)); }
+    static void top(const V v, float *p) { _mm_storeu_ps(p, _mm256_extractf128_ps(v, 1)); }
+    static V shiftIn(const V prev, const V v) { return _mm256_permute2f128_ps(prev, v, 0x21); }
+    template <int> static V shiftUp(const V v) { return _mm256_permute2f128_ps(v, v, 0x08); }
+    static V broadcastTop(const V v) { return _mm256_permute2f128_ps(v, v, 0x11); }
+
+    static V loadDown(const float *l, const float *r)
+    {
+        const auto pairsL = _mm_loadu_pd(reinterpret_cast<const double *>(l));
+        const auto pairsR = _mm_loadu_pd(reinterpret_cast<const double *>(r));
+        return _mm256_castpd_ps(_mm256_set_m128d(_mm_unpackhi_pd(pairsL, pairsR), _mm_unpacklo_pd(pairsL, pairsR)));
+    }
+    static void storeDown(float *l, float *r, const V v)
+    {
+        const auto sums = _mm256_mul_ps(_mm256_add_ps(v, _mm256_permute_ps(v, _MM_SHUFFLE(2, 3, 0, 1))), _mm256_set1_ps(0.5f));
+        const auto packed = _mm256_castps256_ps128(_mm256_permutevar8x32_ps(sums, _mm256_setr_epi32(0, 4, 2, 6, 0, 0, 0, 0)));
+        _mm_storel_pi(reinterpret_cast<__m64 *>(l), packed);
+        _mm_storeh_pi(reinterpret_cast<__m64 *>(r), packed);
+    }
+    static V loadUp(const float *l, const float *r)
+    {
+        const auto lr = _mm_unpacklo_pd(_mm_load_sd(reinterpret_cast<const double *>(l)), _mm_load_sd(reinterpret_cast<const double *>(r)));
+        return _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_castpd_ps(lr)), _mm256_setr_epi32(0, 0, 2, 2, 1, 1, 3, 3));
+    }
+    static void storeUp(float *l, float *r, const V v)
+    {
+        const auto ordered = _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(1, 0, 5, 4, 3, 2, 7, 6));
+        _mm_storeu_ps(l, _mm256_castps256_ps128(ordered));
+        _mm_storeu_ps(r, _mm256_extractf128_ps(ordered, 1));
+    }
+};
+} // namespace
+
+void downsampleAvx2(State &st, float *outL, float *outR, const float *inL, const float *inR, const int numOut)
+{
+    downsample<Isa8>(st, outL, outR, inL, inR, numOut);
+}
+
+void upsampleAvx2(State &st, float *outL, float *outR, const float *inL, const float *inR, const int numIn)
+{
+    upsample<Isa8>(st, outL, outR, inL, inR, numIn);
+}
+} // namespace polyphase
+#endif
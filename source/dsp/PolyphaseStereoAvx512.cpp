@@ -0,0 +1,66 @@
+// Built with AVX-512 enabled (see CMakeLists.txt); only called when the CPU has it.
+#include "PolyphaseKernels.h"
+
+#if USE_SSE
+#include <immintrin.h>
+
+namespace polyphase
+{
+namespace
+{
+// four groups: four samples per step
+struct Isa16
+{
+    using V = __m512;
+    static constexpr int groups = 4;
+    static V load(const float *p) { return _mm512_loadu_ps(p); }
+    static V mul(const V a, const V b) { return _mm512_mul_ps(a, b); }
+    static V fma(const V a, const V b, const V c) { return _mm512_fmadd_ps(a, b, c); }
+    static V broadcast(const float *p) { return _mm512_broadcast_f32x4(_mm_loadu_ps(p)); }
+    static void top(const V v, float *p) { _mm_storeu_ps(p, _mm512_extractf32x4_ps(v, 3)); }
+    static V shiftIn(const V prev, const V v) { return cast(_mm512_alignr_epi32(cast(v), cast(prev), 12)); }
+    template <int N> static V shiftUp(const V v) { return cast(_mm512_alignr_epi32(cast(v), _mm512_setzero_si512(), 16 - 4 * N)); }
+    static V broadcastTop(const V v) { return _mm512_shuffle_f32x4(v, v, 0xff); }
+
+    static V loadDown(const float *l, const float *r)
+    {
+        const auto both = _mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_loadu_pd(reinterpret_cast<const double *>(l))),
+                                             _mm256_loadu_pd(reinterpret_cast<const double *>(r)), 1);
+        return _mm512_castpd_ps(_mm512_permutexvar_pd(_mm512_setr_epi64(0, 4, 1, 5, 2, 6, 3, 7), both));
+    }
+    static void storeDown(float *l, float *r, const V v)
+    {
+        const auto swapped = _mm512_permute_ps(v, _MM_SHUFFLE(2, 3, 0, 1));
+        const auto sums = _mm512_mul_ps(_mm512_add_ps(v, swapped), _mm512_set1_ps(0.5f));
+        const auto packed = _mm512_permutexvar_ps(_mm512_setr_epi32(0, 4, 8, 12, 2, 6, 10, 14, 0, 0, 0, 0, 0, 0, 0, 0), sums);
+        _mm_storeu_ps(l, _mm512_castps512_ps128(packed));
+        _mm_storeu_ps(r, _mm512_extractf32x4_ps(packed, 1));
+    }
+    static V loadUp(const float *l, const float *r)
+    {
+        const auto both = _mm512_insertf32x4(_mm512_castps128_ps512(_mm_loadu_ps(l)), _mm_loadu_ps(r), 1);
+        return _mm512_permutexvar_ps(_mm512_setr_epi32(0, 0, 4, 4, 1, 1, 5, 5, 2, 2, 6, 6, 3, 3, 7, 7), both);
+    }
+    static void storeUp(float *l, float *r, const V v)
+    {
+        const auto ordered = _mm512_permutexvar_ps(_mm512_setr_epi32(1, 0, 5, 4, 9, 8, 13, 12, 3, 2, 7, 6, 11, 10, 15, 14), v);
+        _mm256_storeu_ps(l, _mm512_castps512_ps256(ordered));
+        _mm256_storeu_pd(reinterpret_cast<double *>(r), _mm512_extractf64x4_pd(_mm512_castps_pd(ordered), 1));
+    }
+
+    static __m512i cast(const V v) { return _mm512_castps_si512(v); }
+    static V cast(const __m512i v) { return _mm512_castsi512_ps(v); }
+};
+} // namespace
+
+void downsampleAvx512(State &st, float *outL, float *outR, const float *inL, const float *inR, const int numOut)
+{
+    downsample<Isa16>(st, outL, outR, inL, inR, numOut);
+}
+
+void upsampleAvx512(State &st, float *outL, float *outR, const float *inL, const float *inR, const int numIn)
+{
+    upsample<Isa16>(st, outL, outR, inL, inR, numIn);
+}
+} // namespace polyphase
+#endif
@@ -0,0 +1,229 @@
+#include "RenderPool.h"
+#include <thread>
+#include "PMProcessor.h"
+
+//==============================================================================
+class RenderPool::Worker final : public juce::Thread
+{
+  public:
+    Worker(RenderPool &owner_, const int core_)
+        : juce::Thread("PM Daze voices " + juce::String(core_)), owner(owner_), core(core_), bank(owner_.proc)
+    {
+    }
+    ~Worker() override { stopThread(1000); }
+
+    void run() override
+    {
+        setCurrentThreadAffinityMask(juce::uint32(1) << core);
+        juce::ScopedNoDenormals noDenormals; // as on the audio thread, for the filters' sake
+
+        int idle = 0;
+        while (!threadShouldExit())
+        {
+            // the audio thread puts a generation in 'ticket' to let us in, and may take it back if
+            // it got through the groups before we woke up
+            auto gen = ticket.load(std::memory_order_acquire);
+            if (gen == 0)
+            {
+                if (++idle < spinLimit)
+                {
+                    std::this_thread::yield();
+                }
+                else
+                {
+                    // until the audio thread hands us a block, or the pool stops us
+                    sleeping.store(true);
+                    if (ticket.load() == 0)
+                        wait(-1);
+                    sleeping.store(false);
+                }
+                continue;
+            }
+            if (!ticket.compare_exchange_strong(gen, 0, std::memory_order_acq_rel))
+                continue;
+
+            idle = 0;
+            output.clear(0, owner.jobSamples);
+            rendered = owner.runJobs(bank, output, 0);
+            finished.store(gen, std::memory_order_release);
+        }
+    }
+
+    static constexpr int spinLimit = 4096; // yields before going to sleep between blocks
+
+    RenderPool &owner;
+    const int core;
+    VoiceBank bank;
+    juce::AudioBuffer<float> output;
+    bool rendered{false};
+
+    alignas(64) std::atomic<uint32_t> ticket{0};
+    std::atomic<uint32_t> finished{0};
+    std::atomic<bool> sleeping{false};
+};
+
+//==============================================================================
+RenderPool::RenderPool(PMProcessor &p) : proc(p), bank(p) {}
+
+RenderPool::~RenderPool() = default;
+
+void RenderPool::prepare(const int maxSamples)
+{
+    preparedSamples = maxSamples;
+    bank.setMaxBlockSize(maxSamples);
+    active.reserve(VoiceBank::maxVoices);
+    ordered.reserve(VoiceBank::maxVoices);
+    groups.reserve(VoiceBank::maxVoices);
+
+    stopWorkers();
+    if (multiThreaded)
+        startWorkers();
+}
+
+void RenderPool::setMultiThreaded(const bool shouldBe)
+{
+    if (shouldBe == multiThreaded)
+        return;
+    multiThreaded = shouldBe;
+
+    if (preparedSamples == 0) // prepare() will start them
+        return;
+    if (multiThreaded)
+        startWorkers();
+    else
+        stopWorkers();
+}
+
+void RenderPool::startWorkers()
+{
+    if (workers.empty())
+    {
+        // one worker per spare core, leaving core 0 to the host
+        const int numWorkers = juce::jlimit(0, 7, juce::SystemStats::getNumCpus() - 1);
+        for (int i = 0; i < numWorkers; i++)
+            workers.push_back(std::make_unique<Worker>(*this, i + 1));
+    }
+
+    for (auto &w : workers)
+    {
+        w->bank.setMaxBlockSize(preparedSamples);
+        if (tables != nullptr)
+            w->bank.setTables(*tables);
+        w->output.setSize(2, preparedSamples);
+        w->ticket.store(0);
+        if (!w->startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(10)))
+            w->startThread(juce::Thread::Priority::highest);
+    }
+}
+
+void RenderPool::stopWorkers()
+{
+    for (auto &w : workers)
+        w->stopThread(1000);
+}
+
+void RenderPool::setTables(gin::BandLimitedLookupTables &newTables)
+{
+    tables = &newTables;
+    bank.setTables(newTables);
+    for (auto &w : workers)
+        w->bank.setTables(newTables);
+}
+
+void RenderPool::render(const juce::OwnedArray<juce::MPESynthesiserVoice> &voices, juce::AudioBuffer<float> &output, const int startSample,
+                        const int numSamples)
+{
+    active.clear();
+    for (auto *v : voices)
+    {
+        if (v->isActive())
+            active.push_back(static_cast<PMVoice *>(v));
+    }
+    render(active.data(), static_cast<int>(active.size()), output, startSample, numSamples);
+}
+
+void RenderPool::render(PMVoice *const *voices, const int numVoices, juce::AudioBuffer<float> &output, const int startSample,
+                        const int numSamples)
+{
+    if (numVoices == 0)
+        return;
+
+    // all voices share the control ticks, so their LFOs and MSEGs can be updated together
+    if (const int divisor = proc.getControlDivisor(); divisor != controlDivisor)
+    {
+        controlDivisor = divisor;
+        tilUpdate = 0;
+    }
+    const bool controlTick = tilUpdate == 0;
+    tilUpdate = controlTick ? controlDivisor - 1 : tilUpdate - 1;
+
+    if (controlTick)
+    {
+        for (int v = 0; v < numVoices; v++)
+            voices[v]->updateSources();
+        proc.modulators.process(voices, numVoices, numSamples);
+        proc.routing.evaluate(voices, numVoices, controlDivisor * numSamples / voices[0]->getSampleRate());
+    }
+    for (int v = 0; v < numVoices; v++)
+        voices[v]->startRender(numSamples, controlTick);
+
+    VoiceBank::groupVoices(voices, numVoices, ordered, groups);
+
+    jobSamples = numSamples;
+    nextGroup.store(0, std::memory_order_relaxed);
+    bank.beginBlock();
+
+    if (multiThreaded && !workers.empty() && groups.size() > 1)
+    {
+        if (++generation == 0)
+            ++generation;
+
+        for (auto &w : workers)
+        {
+            w->bank.beginBlock();
+            // sequentially consistent, as is the worker's 'sleeping' flag: a worker that goes to sleep
+            // either sees its ticket first or gets woken here
+            w->ticket.store(generation);
+            if (w->sleeping.load())
+                w->notify();
+        }
+
+        runJobs(bank, output, startSample);
+
+        for (auto &w : workers)
+        {
+            // a worker that hasn't picked up its ticket yet is left out of this block
+            auto gen = generation;
+            if (w->ticket.compare_exchange_strong(gen, 0, std::memory_order_acq_rel))
+                continue;
+
+            while (w->finished.load(std::memory_order_acquire) != generation)
+                std::this_thread::yield();
+
+            if (w->rendered)
+            {
+                output.addFrom(0, startSample, w->output, 0, 0, numSamples);
+                output.addFrom(1, startSample, w->output, 1, 0, numSamples);
+            }
+        }
+    }
+    else
+    {
+        runJobs(bank, output, startSample);
+    }
+
+    for (int v = 0; v < numVoices; v++)
+        voices[v]->applyPendingStop();
+}
+
+bool RenderPool::runJobs(VoiceBank &b, juce::AudioBuffer<float> &output, const int startSample)
+{
+    bool any = false;
+    for (int g = nextGroup.fetch_add(1); g < static_cast<int>(groups.size()); g = nextGroup.fetch_add(1))
+    {
+        const auto &group = groups[size_t(g)];
+        b.renderGroup(ordered.data() + group.first, group.count, output, startSample, jobSamples);
+        any = true;
+    }
+    return any;
+}
@@ -0,0 +1,79 @@
+/*
+ * PM Daze - an expressive, semi-modular, phase-modulation synthesizer
+ *
+ * Copyright 2025, Greg Recco
+ *
+ * PM Daze is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source code for PM Daze is available at
+ * https://github.com/gregrecco67/PMDaze
+ */
+
+#pragma once
+
+#include <atomic>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include "VoiceBank.h"
+
+class PMProcessor;
+
+//==============================================================================
+// Spreads the voice groups of each block over the audio thread and, when
+// multi-threading is on, a few worker threads pinned to the other cores.
+// Every thread has its own VoiceBank and output buffer; the audio thread
+// sums the workers' buffers once all groups are done. Work is handed out
+// through an atomic group index, so nobody takes a lock to get a job. The
+// workers only run while multi-threading is on, and sleep until they're
+// handed a block.
+//
+// Voice parameters are updated and voices are stopped on the audio thread
+// only, before and after the parallel part.
+class RenderPool
+{
+  public:
+    explicit RenderPool(PMProcessor &p);
+    ~RenderPool();
+
+    // message thread: sizes the buffers, and restarts the workers if multi-threading is on
+    void prepare(int maxSamples);
+    void setTables(gin::BandLimitedLookupTables &tables);
+
+    // message thread, while the audio thread is kept out: starts or stops the workers
+    void setMultiThreaded(bool shouldBe);
+
+    // renders all active voices in 'voices' and adds them to 'output'
+    void render(const juce::OwnedArray<juce::MPESynthesiserVoice> &voices, juce::AudioBuffer<float> &output, int startSample,
+                int numSamples);
+    void render(PMVoice *const *voices, int numVoices, juce::AudioBuffer<float> &output, int startSample, int numSamples);
+
+  private:
+    class Worker;
+
+    // renders groups until there are none left; true if it rendered any
+    bool runJobs(VoiceBank &bank, juce::AudioBuffer<float> &output, int startSample);
+
+    void startWorkers();
+    void stopWorkers();
+
+    PMProcessor &proc;
+    VoiceBank bank; // the audio thread's
+    std::vector<std::unique_ptr<Worker>> workers;
+    gin::BandLimitedLookupTables *tables{nullptr}; // for workers started later
+    bool multiThreaded{false};
+    int preparedSamples{0};
+    int tilUpdate{0}, controlDivisor{0}; // voice modulation runs on every controlDivisor-th block
+
+    std::vector<PMVoice *> active, ordered;
+    std::vector<VoiceBank::Group> groups;
+
+    // the current job, written by the audio thread before the workers are let in
+    int jobSamples{0};
+    uint32_t generation{0};
+    alignas(64) std::atomic<int> nextGroup{0};
+
+    JUCE_DECLARE_NON_COPYABLE(RenderPool)
+};
@@ -0,0 +1,77 @@
+/*
+ * PM Daze - an expressive, semi-modular, phase-modulation synthesizer
+ *
+ * Copyright 2025, Greg Recco
+ *
+ * PM Daze is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source code for PM Daze is available at
+ * https://github.com/gregrecco67/PMDaze
+ */
+
+#pragma once
+
+#include <gin_plugin/gin_plugin.h>
+#include <vector>
+
+//==============================================================================
+// The host's tempo and position, read from the play head once per host
+// block. The length of every note duration is kept in a table that is only
+// rebuilt when the tempo changes, so tempo-synced LFOs, envelopes, MSEGs and
+// delays all look their times up here instead of asking the host each time.
+class TransportSnapshot
+{
+  public:
+    TransportSnapshot()
+    {
+        const auto &notes = gin::NoteDuration::getNoteDurations();
+        seconds.resize(notes.size());
+        rates.resize(notes.size());
+        setBpm(120.0);
+    }
+
+    // audio thread, at the top of each host block
+    void update(juce::AudioPlayHead *playhead)
+    {
+        double newBpm = 120.0;
+        if (playhead != nullptr)
+        {
+            if (auto position = playhead->getPosition())
+            {
+                newBpm = position->getBpm().orFallback(120.0);
+                ppqPosition = position->getPpqPosition().orFallback(0.0);
+            }
+        }
+        if (newBpm != bpm)
+            setBpm(newBpm);
+    }
+
+    // 'index' is a note duration parameter's value
+    [[nodiscard]] inline float noteSeconds(const float index) const { return seconds[slot(index)]; }
+    [[nodiscard]] inline float noteRate(const float index) const { return rates[slot(index)]; }
+
+    double bpm{0.0}, ppqPosition{0.0};
+
+  private:
+    void setBpm(const double newBpm)
+    {
+        bpm = newBpm;
+        const auto &notes = gin::NoteDuration::getNoteDurations();
+        for (size_t i = 0; i < notes.size(); i++)
+        {
+            seconds[i] = notes[i].toSeconds(float(bpm));
+            rates[i] = 1.0f / seconds[i];
+        }
+    }
+
+    [[nodiscard]] inline size_t slot(const float index) const
+    {
+        jassert(!seconds.empty());
+        return size_t(juce::jlimit(0, int(seconds.size()) - 1, int(index)));
+    }
+
+    std::vector<float> seconds, rates; // indexed like gin::NoteDuration::getNoteDurations()
+};
@@ -0,0 +1,97 @@
+/*
+ * PM Daze - an expressive, semi-modular, phase-modulation synthesizer
+ *
+ * Copyright 2025, Greg Recco
+ *
+ * PM Daze is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source code for PM Daze is available at
+ * https://github.com/gregrecco67/PMDaze
+ */
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <cstring>
+#include "MTS-ESP/libMTSClient.h"
+
+//==============================================================================
+// The frequency of every MIDI note on every channel, as MTS-ESP tunes it, so
+// voices look their base frequency up instead of calling into the MTS library.
+//
+// MTS-ESP doesn't tell clients when the master's tuning changes, so while a
+// master is connected one channel is re-read per host block, and the whole
+// table is re-read when the scale name changes. It is also re-read as soon as
+// a master connects or disconnects, or a tuning sysex arrives. Without a
+// master and without sysex the table never changes and costs nothing.
+class TuningTable
+{
+  public:
+    TuningTable()
+    {
+        for (auto &channel : freqs)
+            for (size_t n = 0; n < numNotes; n++)
+                channel[n] = float(440.0 * std::pow(2.0, (double(n) - 69.0) / 12.0));
+    }
+
+    // audio thread, at the top of each host block
+    void update(MTSClient *client)
+    {
+        if (const bool master = MTS_HasMaster(client); master != hasMaster)
+        {
+            hasMaster = master;
+            dirty = true;
+        }
+
+        if (hasMaster && nextChannel == 0)
+        {
+            const char *name = MTS_GetScaleName(client);
+            if (std::strncmp(name, scaleName.data(), scaleName.size() - 1) != 0)
+            {
+                std::strncpy(scaleName.data(), name, scaleName.size() - 1);
+                dirty = true;
+            }
+        }
+
+        if (dirty)
+        {
+            for (size_t c = 0; c < numChannels; c++)
+                readChannel(client, c);
+            dirty = false;
+        }
+        else if (hasMaster)
+        {
+            readChannel(client, nextChannel);
+        }
+        nextChannel = (nextChannel + 1) % numChannels;
+    }
+
+    // after a tuning sysex has been handed to MTS-ESP
+    void tuningChanged() { dirty = true; }
+
+    // 'channel' is 1-16, as in juce::MPENote
+    [[nodiscard]] inline float frequency(const int note, const int channel) const
+    {
+        return freqs[size_t(juce::jlimit(1, 16, channel) - 1)][size_t(juce::jlimit(0, 127, note))];
+    }
+
+    [[nodiscard]] juce::String getScaleName() const { return juce::String(scaleName.data()); }
+
+  private:
+    static constexpr size_t numChannels = 16, numNotes = 128;
+
+    void readChannel(MTSClient *client, const size_t channel)
+    {
+        for (size_t n = 0; n < numNotes; n++)
+            freqs[channel][n] = float(MTS_NoteToFrequency(client, char(n), char(channel)));
+    }
+
+    std::array<std::array<float, numNotes>, numChannels> freqs;
+    std::array<char, 64> scaleName{};
+    size_t nextChannel{0};
+    bool hasMaster{false}, dirty{true};
+};
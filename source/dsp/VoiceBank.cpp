@@ -0,0 +1,421 @@
+#include "VoiceBank.h"
+#include "FastMath.hpp"
+#include "PMProcessor.h"
+
+VoiceBank::VoiceBank(PMProcessor &p) : proc(p), bllt(&p.upsampledTables), modfmTables(p.modfmTables) {}
+
+void VoiceBank::setMaxBlockSize(const int maxSamples_)
+{
+    maxSamples = maxSamples_;
+    envBuffer.assign(size_t(4 * maxSamples), Lanes(0.f));
+    outBuffer.assign(size_t(maxSamples), Lanes(0.f));
+    envScratch.assign(size_t(4 * maxSamples), 0.f);
+    voiceBuffer.setSize(1, maxSamples);
+}
+
+bool VoiceBank::sameGroup(const PMVoice *a, const PMVoice *b)
+{
+    return a->algo == b->algo && a->opMask == b->opMask && a->w1 == b->w1 && a->w2 == b->w2 && a->w3 == b->w3 && a->w4 == b->w4;
+}
+
+void VoiceBank::groupVoices(PMVoice *const *voices, const int numVoices, std::vector<PMVoice *> &ordered, std::vector<Group> &groups)
+{
+    jassert(numVoices <= maxVoices);
+
+    ordered.clear();
+    groups.clear();
+
+    // voices that share an algorithm and waveforms can run in the same registers
+    std::array<bool, maxVoices> done{};
+    for (int v = 0; v < numVoices; v++)
+    {
+        if (done[size_t(v)])
+            continue;
+
+        Group group{static_cast<int>(ordered.size()), 0};
+        for (int u = v; u < numVoices; u++)
+        {
+            if (!done[size_t(u)] && sameGroup(voices[v], voices[u]))
+            {
+                done[size_t(u)] = true;
+                ordered.push_back(voices[u]);
+                if (++group.count == numLanes)
+                {
+                    groups.push_back(group);
+                    group = {static_cast<int>(ordered.size()), 0};
+                }
+            }
+        }
+        if (group.count > 0)
+            groups.push_back(group);
+    }
+}
+
+void VoiceBank::beginBlock()
+{
+    modfm = proc.globalParams.modfm->isOn();
+    filterType = juce::jlimit(0, 7, proc.filterParams.type->getUserValueInt());
+}
+
+void VoiceBank::renderGroup(PMVoice *const *group, const int count, juce::AudioBuffer<float> &output, const int startSample,
+                            const int numSamples)
+{
+    jassert(numSamples <= maxSamples);
+
+    auto *envs = reinterpret_cast<float *>(envBuffer.data());
+    const int opStride = maxSamples * numLanes;
+
+    for (int l = 0; l < numLanes; l++)
+    {
+        if (l < count)
+        {
+            group[l]->renderEnvelopes(envScratch.data(), maxSamples, envs + l, numLanes, opStride, numSamples);
+        }
+        else
+        {
+            for (int op = 0; op < 4; op++)
+                for (int i = 0; i < numSamples; i++)
+                    envs[op * opStride + i * numLanes + l] = 0.f;
+        }
+    }
+
+    load(group, count, numSamples);
+    const auto algo = size_t(juce::jlimit(0, PMVoice::numAlgorithms - 1, group[0]->algo));
+    (this->*kernels[modfm ? 1 : 0][algo][size_t(group[0]->opMask)])(numSamples);
+    (this->*filterKernels[size_t(filterType)])(numSamples);
+    store(group, count);
+
+    // each voice finishes (gain, mix) straight out of the shared buffer
+    const auto *out = reinterpret_cast<const float *>(outBuffer.data());
+    voiceBuffer.setSize(1, numSamples, false, false, true);
+    for (int l = 0; l < count; l++)
+    {
+        auto *dest = voiceBuffer.getWritePointer(0);
+        for (int i = 0; i < numSamples; i++)
+            dest[i] = out[i * numLanes + l];
+        group[l]->finishRender(voiceBuffer, output, startSample, numSamples);
+    }
+}
+
+void VoiceBank::load(PMVoice *const *group, const int count, const int numSamples)
+{
+    const auto *first = group[0];
+    const double invSampleRate = 1.0 / first->getSampleRate();
+
+    waves = {first->w1, first->w2, first->w3, first->w4};
+
+    for (int l = 0; l < numLanes; l++)
+    {
+        const auto *v = group[l < count ? l : 0];
+        const bool used = l < count;
+        const auto s = size_t(l);
+
+        const std::array<uint32_t, 4> p{v->phase1, v->phase2, v->phase3, v->phase4};
+        for (size_t op = 0; op < 4; op++)
+        {
+            const auto &ramp = v->freqRamps[op];
+            const uint32_t startInc = used ? PMVoice::toPhase(ramp.start * invSampleRate) : 0;
+            const uint32_t endInc = used ? PMVoice::toPhase(ramp.current * invSampleRate) : 0;
+            freq[op][s] = ramp.start;
+            freqStep[op][s] = ramp.step;
+            inc[op][s] = startInc;
+            // signed difference over the block, kept as its two's complement so adding it wraps the right way
+            incStep[op][s] = static_cast<uint32_t>(static_cast<int32_t>(endInc - startInc) / std::max(numSamples, 1));
+            phase[op][s] = used ? p[op] : 0;
+        }
+
+        for (size_t op = 0; op < 4; op++)
+        {
+            volume[op].set(s, used ? v->volRamps[op].start : 0.f);
+            volumeStep[op].set(s, used ? v->volRamps[op].step : 0.f);
+        }
+        modIndex.set(s, v->modIndexRamp.start);
+        modIndexStep.set(s, v->modIndexRamp.step);
+        antipop.set(s, used ? v->antipop : 0.f);
+
+        avg[1].load(s, v->a2, used);
+        avg[2].load(s, v->a3, used);
+        avg[3].load(s, v->a4, used);
+
+        // SVF coefficients at both ends of the block; the kernel ramps between them
+        const auto coefs = [](const float g, const float k) {
+            const float a1 = 1.0f / (1.0f + g * (g + k));
+            return std::array<float, 4>{a1, g * a1, g * g * a1, k};
+        };
+        const auto from = coefs(v->filterG.start, v->filterK.start);
+        const auto to = coefs(v->filterG.current, v->filterK.current);
+        const float perSample = 1.0f / static_cast<float>(std::max(1, numSamples));
+        fa1.set(s, from[0]);
+        fa2.set(s, from[1]);
+        fa3.set(s, from[2]);
+        fk.set(s, from[3]);
+        fa1Step.set(s, (to[0] - from[0]) * perSample);
+        fa2Step.set(s, (to[1] - from[1]) * perSample);
+        fa3Step.set(s, (to[2] - from[2]) * perSample);
+        fkStep.set(s, (to[3] - from[3]) * perSample);
+        for (size_t stage = 0; stage < 2; stage++)
+        {
+            ic1[stage].set(s, used ? v->filterState[stage * 2] : 0.f);
+            ic2[stage].set(s, used ? v->filterState[stage * 2 + 1] : 0.f);
+        }
+    }
+}
+
+void VoiceBank::store(PMVoice *const *group, const int count)
+{
+    for (int l = 0; l < count; l++)
+    {
+        auto *v = group[l];
+        const auto s = size_t(l);
+
+        v->phase1 = phase[0][s];
+        v->phase2 = phase[1][s];
+        v->phase3 = phase[2][s];
+        v->phase4 = phase[3][s];
+        v->antipop = antipop.get(s);
+
+        avg[1].store(s, v->a2);
+        avg[2].store(s, v->a3);
+        avg[3].store(s, v->a4);
+
+        for (size_t stage = 0; stage < 2; stage++)
+        {
+            v->filterState[stage * 2] = ic1[stage].get(s);
+            v->filterState[stage * 2 + 1] = ic2[stage].get(s);
+        }
+    }
+}
+
+// Andy Simper's trapezoidal state-variable filter, one voice per lane
+template <int Response> VoiceBank::Lanes VoiceBank::svf(const size_t stage, const Lanes v0)
+{
+    auto &s1 = ic1[stage];
+    auto &s2 = ic2[stage];
+    const Lanes v3 = v0 - s2;
+    const Lanes v1 = fa1 * s1 + fa2 * v3;
+    const Lanes v2 = s2 + fa2 * s1 + fa3 * v3;
+    s1 = v1 + v1 - s1;
+    s2 = v2 + v2 - s2;
+
+    if constexpr (Response == lowpass)
+        return v2;
+    else if constexpr (Response == highpass)
+        return v0 - fk * v1 - v2;
+    else if constexpr (Response == bandpass)
+        return v1; // a gain of Q at the centre, as gin::Filter had
+    else
+        return v0 - fk * v1;
+}
+
+template <int Response, bool TwoStage> void VoiceBank::filterLanes(const int numSamples)
+{
+    for (int i = 0; i < numSamples; i++)
+    {
+        auto &x = outBuffer[size_t(i)];
+        x = svf<Response>(0, x);
+        if constexpr (TwoStage)
+            x = svf<Response>(1, x);
+
+        fa1 += fa1Step;
+        fa2 += fa2Step;
+        fa3 += fa3Step;
+        fk += fkStep;
+    }
+}
+
+// indexed by the filter type parameter
+const std::array<VoiceBank::Kernel, 8> VoiceBank::filterKernels{
+    &VoiceBank::filterLanes<lowpass, false>,  &VoiceBank::filterLanes<lowpass, true>,  &VoiceBank::filterLanes<highpass, false>,
+    &VoiceBank::filterLanes<highpass, true>,  &VoiceBank::filterLanes<bandpass, false>, &VoiceBank::filterLanes<bandpass, true>,
+    &VoiceBank::filterLanes<notch, false>,    &VoiceBank::filterLanes<notch, true>,
+};
+
+void VoiceBank::advancePhases()
+{
+    for (size_t op = 0; op < 4; op++)
+    {
+        for (size_t l = 0; l < size_t(numLanes); l++)
+        {
+            phase[op][l] += inc[op][l]; // wraps around by itself
+            inc[op][l] += incStep[op][l];
+            freq[op][l] += freqStep[op][l];
+        }
+    }
+}
+
+template <bool ModFM> VoiceBank::Lanes VoiceBank::w(const size_t op, const Lanes mod, const bool isMod)
+{
+    alignas(Lanes) float ph[numLanes];
+    mod.copyToRawArray(ph);
+
+    // phase modulation is added as a fixed-point offset, then the top 24 bits
+    // give an exactly representable float in [0, 1)
+    for (size_t l = 0; l < size_t(numLanes); l++)
+    {
+        const auto offset = static_cast<uint32_t>(static_cast<int64_t>(ph[l] * 4294967296.0f));
+        ph[l] = static_cast<float>((phase[op][l] + offset) >> 8) * (1.0f / 16777216.0f);
+    }
+
+    Lanes out;
+    if (ModFM && isMod)
+    {
+        if (waves[op] == gin::Wave::sine)
+        {
+            for (size_t l = 0; l < size_t(numLanes); l++)
+                out.set(l, modfmTables.sine(ph[l]));
+        }
+        else
+        {
+            for (size_t l = 0; l < size_t(numLanes); l++)
+                out.set(l, modfmTables.shape(bllt->process(waves[op], freq[op][l], ph[l])));
+        }
+    }
+    else if (waves[op] == gin::Wave::sine)
+    {
+        // sin(2 pi p) == sin((0.5 - p) * 2 pi), and the latter stays within [-pi, pi]
+        out = FastMath<float>::simdSin((Lanes(0.5f) - Lanes::fromRawArray(ph)) * juce::MathConstants<float>::twoPi);
+    }
+    else
+    {
+        for (size_t l = 0; l < size_t(numLanes); l++)
+            out.set(l, bllt->process(waves[op], freq[op][l], ph[l]));
+    }
+    return out;
+}
+
+template <int Algo, int Mask, bool ModFM> void VoiceBank::renderAlgo(const int numSamples)
+{
+    if constexpr (Mask == 0)
+    {
+        // nothing reaches the output: keep the phases running and write silence
+        const auto n = static_cast<uint32_t>(numSamples);
+        for (size_t op = 0; op < 4; op++)
+        {
+            for (size_t l = 0; l < size_t(numLanes); l++)
+            {
+                phase[op][l] += inc[op][l] * n + incStep[op][l] * (n * (n - 1) / 2);
+                inc[op][l] += incStep[op][l] * n;
+                freq[op][l] += freqStep[op][l] * static_cast<float>(numSamples);
+            }
+        }
+        antipop = Lanes::min(antipop + .03f * static_cast<float>(numSamples), Lanes(1.0f));
+        std::fill(outBuffer.begin(), outBuffer.begin() + numSamples, Lanes(0.f));
+        return;
+    }
+
+    const Lanes zero{0.f};
+    std::array<Lanes, 4> e;
+
+    // culled operators contribute nothing, and whatever feeds them is never evaluated
+    const auto vol = [this](auto op) { return volume[op]; };
+    const auto mod = [&](auto op, auto &&in) {
+        if constexpr (((Mask >> decltype(op)::value) & 1) == 0)
+            return zero;
+        else
+            return e[op] * vol(op) * modIndex * avg[op].p(w<ModFM>(op, in(), true));
+    };
+    const auto car = [&](auto op, auto &&in, const bool isMod) {
+        if constexpr (((Mask >> decltype(op)::value) & 1) == 0)
+            return zero;
+        else
+            return e[op] * vol(op) * w<ModFM>(op, in(), isMod);
+    };
+    const auto none = [&] { return zero; };
+
+    constexpr std::integral_constant<size_t, 0> op1;
+    constexpr std::integral_constant<size_t, 1> op2;
+    constexpr std::integral_constant<size_t, 2> op3;
+    constexpr std::integral_constant<size_t, 3> op4;
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        advancePhases();
+
+        // "e[0]" is the output of the envelope selected for osc 1, and so on
+        for (size_t op = 0; op < 4; op++)
+            e[op] = envBuffer[op * size_t(maxSamples) + size_t(i)];
+
+        Lanes o{0.f};
+
+        // clang-format off
+        if constexpr (Algo == 0) {
+            o = car(op1, [&] { return mod(op2, [&] { return mod(op3, [&] { return mod(op4, none); }); }); }, false);
+        }
+        else if constexpr (Algo == 1) {
+            o = car(op1, [&] { return mod(op2, [&] { return mod(op3, none) + mod(op4, none); }); }, false);
+        }
+        else if constexpr (Algo == 2) {
+            o = car(op1, [&] { return mod(op2, [&] { return mod(op3, none); }) + mod(op4, none); }, true);
+        }
+        else if constexpr (Algo == 3) {
+            const auto p4 = mod(op4, none);
+            const auto p3 = mod(op3, [&] { return p4; });
+            const auto p2 = mod(op2, [&] { return p4; });
+            o = car(op1, [&] { return p2 + p3; }, false);
+        }
+        else if constexpr (Algo == 4) {
+            const auto p43 = mod(op3, [&] { return mod(op4, none); });
+            const auto out2 = car(op2, [&] { return p43; }, false);
+            const auto out1 = car(op1, [&] { return p43; }, false);
+            o = (out1 + out2) * 0.5f;
+        }
+        else if constexpr (Algo == 5) {
+            const auto out2 = car(op2, [&] { return mod(op3, [&] { return mod(op4, none); }); }, true);
+            const auto out1 = car(op1, none, false);
+            o = (out1 + out2) * 0.5f;
+        }
+        else if constexpr (Algo == 6) {
+            const auto p4 = mod(op4, none);
+            const auto p3 = mod(op3, none);
+            const auto p2 = mod(op2, none);
+            o = car(op1, [&] { return p2 + p3 + p4; }, false);
+        }
+        else if constexpr (Algo == 7) {
+            const auto out1 = car(op1, [&] { return mod(op2, none); }, false);
+            const auto out3 = car(op3, [&] { return mod(op4, none); }, false);
+            o = (out1 + out3) * 0.5f;
+        }
+        else if constexpr (Algo == 8) {
+            const auto p4 = mod(op4, none);
+            const auto out3 = car(op3, [&] { return p4; }, false);
+            const auto out2 = car(op2, [&] { return p4; }, false);
+            const auto out1 = car(op1, [&] { return p4; }, false);
+            o = (out1 + out2 + out3) * 0.3333333333333333f;
+        }
+        else if constexpr (Algo == 9) {
+            const auto out3 = car(op3, [&] { return mod(op4, none); }, true);
+            const auto out2 = car(op2, none, false);
+            const auto out1 = car(op1, none, false);
+            o = (out1 + out2 + out3) * 0.3333333333333333f;
+        }
+        else if constexpr (Algo == 10) {
+            const auto out4 = car(op4, none, false);
+            const auto out3 = car(op3, none, false);
+            const auto out2 = car(op2, none, false);
+            const auto out1 = car(op1, none, false);
+            o = (out1 + out2 + out3 + out4) * 0.25f;
+        }
+        // clang-format on
+
+        outBuffer[size_t(i)] = o * antipop;
+
+        antipop = Lanes::min(antipop + .03f, Lanes(1.0f));
+        for (size_t op = 0; op < 4; op++)
+            volume[op] += volumeStep[op];
+        modIndex += modIndexStep;
+    }
+}
+
+// one kernel per algorithm and set of live operators, so the operator graph is known at compile time
+template <bool ModFM, int Algo, int... Masks> static constexpr std::array<VoiceBank::Kernel, 16> masksFor(std::integer_sequence<int, Masks...>)
+{
+    return {&VoiceBank::renderAlgo<Algo, Masks, ModFM>...};
+}
+
+template <bool ModFM, int... Algos> static constexpr VoiceBank::KernelTable kernelsFor(std::integer_sequence<int, Algos...>)
+{
+    return {masksFor<ModFM, Algos>(std::make_integer_sequence<int, 16>())...};
+}
+
+const std::array<VoiceBank::KernelTable, 2> VoiceBank::kernels{kernelsFor<false>(std::make_integer_sequence<int, PMVoice::numAlgorithms>()),
+                                                               kernelsFor<true>(std::make_integer_sequence<int, PMVoice::numAlgorithms>())};
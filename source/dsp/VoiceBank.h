@@ -0,0 +1,107 @@
+/*
+ * PM Daze - an expressive, semi-modular, phase-modulation synthesizer
+ *
+ * Copyright 2025, Greg Recco
+ *
+ * PM Daze is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source code for PM Daze is available at
+ * https://github.com/gregrecco67/PMDaze
+ */
+
+#pragma once
+
+#include <gin_dsp/gin_dsp.h>
+#include <juce_dsp/juce_dsp.h>
+#include "PMVoice.h"
+
+class PMProcessor;
+
+//==============================================================================
+// Renders the operators of several voices in lockstep, one voice per SIMD lane.
+// Voices are grouped by algorithm and waveforms, their operator state is
+// gathered into lane registers for the block and written back afterwards.
+// The voices' filters run here too, on the group's operator output, with
+// their coefficients ramped per sample. Envelopes and everything else
+// per-voice stays in PMVoice.
+// A VoiceBank belongs to one thread; RenderPool hands it groups to render.
+class VoiceBank
+{
+  public:
+    using Lanes = juce::dsp::SIMDRegister<float>;
+    static constexpr int numLanes = static_cast<int>(Lanes::SIMDNumElements);
+    static constexpr int maxVoices = 64;
+
+    explicit VoiceBank(PMProcessor &p);
+
+    void setMaxBlockSize(int maxSamples);
+    void setTables(gin::BandLimitedLookupTables &tables) { bllt = &tables; }
+
+    // voices that can share registers: ordered[first] .. ordered[first + count - 1]
+    struct Group
+    {
+        int first, count;
+    };
+    static void groupVoices(PMVoice *const *voices, int numVoices, std::vector<PMVoice *> &ordered, std::vector<Group> &groups);
+
+    // call once per block before renderGroup(), on the audio thread
+    void beginBlock();
+    // renders a group of at most numLanes started voices, and adds them to 'output'
+    void renderGroup(PMVoice *const *group, int count, juce::AudioBuffer<float> &output, int startSample, int numSamples);
+
+  private:
+    void load(PMVoice *const *group, int count, int numSamples);
+    void store(PMVoice *const *group, int count);
+
+    [[nodiscard]] static bool sameGroup(const PMVoice *a, const PMVoice *b);
+
+  public:
+    // one kernel per algorithm, mask of live operators and ModFM on/off
+    template <int Algo, int Mask, bool ModFM> void renderAlgo(int numSamples);
+    using Kernel = void (VoiceBank::*)(int numSamples);
+    using KernelTable = std::array<std::array<Kernel, 16>, PMVoice::numAlgorithms>;
+
+  private:
+    static const std::array<KernelTable, 2> kernels;
+
+    // one filter kernel per filter type: lowpass, highpass, bandpass and notch, at 12 and 24 dB/oct
+    enum FilterResponse
+    {
+        lowpass,
+        highpass,
+        bandpass,
+        notch
+    };
+    template <int Response, bool TwoStage> void filterLanes(int numSamples);
+    template <int Response> [[nodiscard]] inline Lanes svf(size_t stage, Lanes v0);
+    static const std::array<Kernel, 8> filterKernels;
+
+    template <bool ModFM> [[nodiscard]] inline Lanes w(size_t op, Lanes mod, bool isMod);
+    inline void advancePhases();
+
+    PMProcessor &proc;
+    gin::BandLimitedLookupTables *bllt;
+    const ModFMTables &modfmTables;
+
+    int maxSamples{0};
+    std::vector<Lanes> envBuffer; // [op][sample], one voice per lane
+    std::vector<Lanes> outBuffer; // [sample]
+    std::vector<float> envScratch; // [env][sample], one voice at a time
+    juce::AudioBuffer<float> voiceBuffer; // mono, one voice at a time, from the operators to the mix
+
+    // lane state for the group being rendered
+    std::array<std::array<uint32_t, numLanes>, 4> phase{}, inc{}, incStep{}; // frequencies ramped per sample
+    std::array<std::array<float, numLanes>, 4> freq{}, freqStep{};
+    std::array<gin::Wave, 4> waves{};
+    std::array<Lanes, 4> volume{}, volumeStep{}; // ramped per sample
+    Lanes modIndex{0.f}, modIndexStep{0.f}, antipop{0.f};
+    std::array<PMVoice::Averager<Lanes>, 4> avg{}; // only modulators (ops 2-4) are averaged
+    std::array<Lanes, 2> ic1{}, ic2{}; // filter integrators, per stage
+    Lanes fa1{0.f}, fa2{0.f}, fa3{0.f}, fk{0.f}; // filter coefficients, ramped per sample
+    Lanes fa1Step{0.f}, fa2Step{0.f}, fa3Step{0.f}, fkStep{0.f};
+    bool modfm{false}; // read once per block
+    int filterType{0}; // likewise
+};
@@ -777,6 +777,19 @@ class GlobalBox : public gin::ParamBox
     PMProcessor &proc;
 };
 
+//==============================================================================
+class VoiceBox : public gin::ParamBox
+{
+  public:
+    VoiceBox(const juce::String &name, const PMProcessor &proc) : gin::ParamBox(name)
+    {
+        setName("voice");
+
+        addControl(new APKnob(proc.globalParams.pan, true), 0, 0);
+        addControl(new APKnob(proc.globalParams.spread), 1, 0);
+    }
+};
+
 //==============================================================================
 
 class MainMatrixBox : public gin::ParamBox
@@ -889,7 +902,7 @@ class MacrosBox final : public gin::ParamBox
             const auto ccValue = proc.macroParams.macro1cc->getUserValueInt();
             if (ccValue >= 0)
             {
-                midiLearnButton1.setCCString("CC " + proc.macroParams.macro1cc->getUserValueText());
+                midiLearnButton1.setCCString(proc.macroParams.macro1cc->getUserValueText());
                 clear1.setVisible(true);
             }
             else
@@ -904,7 +917,7 @@ class MacrosBox final : public gin::ParamBox
             const auto ccValue = proc.macroParams.macro2cc->getUserValueInt();
             if (ccValue >= 0)
             {
-                midiLearnButton2.setCCString("CC " + proc.macroParams.macro2cc->getUserValueText());
+                midiLearnButton2.setCCString(proc.macroParams.macro2cc->getUserValueText());
                 clear2.setVisible(true);
             }
             else
@@ -919,7 +932,7 @@ class MacrosBox final : public gin::ParamBox
             const auto ccValue = proc.macroParams.macro3cc->getUserValueInt();
             if (ccValue >= 0)
             {
-                midiLearnButton3.setCCString("CC " + proc.macroParams.macro3cc->getUserValueText());
+                midiLearnButton3.setCCString(proc.macroParams.macro3cc->getUserValueText());
                 clear3.setVisible(true);
             }
             else
@@ -28,7 +28,7 @@ ModEditor::ModEditor(PMProcessor &proc_) : proc(proc_)
     addAndMakeVisible(lfo4);
     addAndMakeVisible(filter);
     addAndMakeVisible(timbre);
-    addAndMakeVisible(global);
+    addAndMakeVisible(voice);
 
     lfo1.setRight(true);
     lfo2.setRight(true);
@@ -39,7 +39,7 @@ ModEditor::ModEditor(PMProcessor &proc_) : proc(proc_)
     macros.setRight(true);
     filter.setRight(true);
     timbre.setRight(true);
-    global.setRight(true);
+    voice.setRight(true);
     proc.globalParams.pitchbendRange->addListener(this);
 
     modsrc.setHeaderRight(false);
@@ -71,7 +71,7 @@ void ModEditor::resized()
 
     setGrid(&timbre, 13, 0, 0, 3, 2);
     setGrid(&filter, 13, 2, 1, 3, 2);
-    setGrid(&global, 13, 4, 2, 3, 2);
+    setGrid(&voice, 13, 4, 2, 3, 2);
     setGrid(&macros, 13, 6, 3, 3, 2);
     modsrc.setBounds(16 * 56, 0, 5 * 56, 326);
     // matrix.setBounds(16 * 56, 326, 5 * 56, 4.328571f * 70 + 23.f);
@@ -46,7 +46,7 @@ class ModEditor : public juce::Component,
     MsegBox msegB{proc, proc.mseg3Params, proc.mseg4Params, proc.mseg3Data, proc.mseg4Data, 3};
     FilterBox filter{"  flt", proc};
     TimbreBox timbre{"  timbre", proc};
-    GlobalBox global{"  global", proc};
+    VoiceBox voice{"  voice", proc};
 
     MacrosBox macros{proc};
     APLNF aplnf;
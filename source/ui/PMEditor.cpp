@@ -84,7 +84,7 @@ void PMEditor::timerCallback()
         return;
     if (MTS_HasMaster(proc.client))
     {
-        scaleName.setText(proc.scaleName, juce::dontSendNotification);
+        scaleName.setText(proc.tuning.getScaleName(), juce::dontSendNotification);
         scaleName.setColour(juce::Label::backgroundColourId,
                             juce::Colour(0xff16171A).brighter(0.3f));
     }
@@ -174,6 +174,70 @@ void PMEditor::addMenuItems(juce::PopupMenu &m)
                                                                                       : 1.0f);
     });
 
+    juce::PopupMenu om;
+    const juce::StringArray factors{"Auto", "1x", "2x", "4x", "8x"};
+    for (int i = 0; i < factors.size(); i++)
+    {
+        om.addItem(factors[i], true, proc.globalParams.oversampling->getUserValueInt() == i,
+                   [this, i] { proc.globalParams.oversampling->setUserValue(static_cast<float>(i)); });
+    }
+    m.addSubMenu("Oversampling", om);
+
+    juce::PopupMenu dm;
+    const juce::StringArray filters{"Low Latency", "Linear Phase"};
+    for (int i = 0; i < filters.size(); i++)
+    {
+        dm.addItem(filters[i], true, proc.globalParams.decimation->getUserValueInt() == i,
+                   [this, i] { proc.globalParams.decimation->setUserValue(static_cast<float>(i)); });
+    }
+    m.addSubMenu("Downsampling Filter", dm);
+
+    juce::PopupMenu rmm;
+    const juce::StringArray rmFilters{"FIR (Linear Phase)", "IIR (Low Latency)"};
+    for (int i = 0; i < rmFilters.size(); i++)
+    {
+        rmm.addItem(rmFilters[i], true, proc.ringmodParams.oversampling->getUserValueInt() == i,
+                    [this, i] { proc.ringmodParams.oversampling->setUserValue(static_cast<float>(i)); });
+    }
+    m.addSubMenu("Ring Mod Oversampling", rmm);
+
+    juce::PopupMenu pm;
+    for (const int n : {1, 2, 4, 6, 8, 12, 16, 24, 32, 48, 64})
+    {
+        pm.addItem(juce::String(n), true, proc.globalParams.polyphony->getUserValueInt() == n,
+                   [this, n] { proc.globalParams.polyphony->setUserValue(static_cast<float>(n)); });
+    }
+    m.addSubMenu("Polyphony", pm);
+
+    juce::PopupMenu rm;
+    const juce::StringArray rates{"Every Block", "Every 2nd", "Every 4th", "Every 8th"};
+    for (int i = 0; i < rates.size(); i++)
+    {
+        rm.addItem(rates[i], true, proc.globalParams.controlRate->getUserValueInt() == i,
+                   [this, i] { proc.globalParams.controlRate->setUserValue(static_cast<float>(i)); });
+    }
+    m.addSubMenu("Mod Resolution", rm);
+
+    juce::PopupMenu sbm;
+    for (int i = 0; i < 4; i++)
+    {
+        sbm.addItem(juce::String(16 << i), true, proc.globalParams.synthBlock->getUserValueInt() == i,
+                    [this, i] { proc.globalParams.synthBlock->setUserValue(static_cast<float>(i)); });
+    }
+    m.addSubMenu("Synth Block Size", sbm);
+
+    juce::PopupMenu fbm;
+    for (int i = 0; i < 4; i++)
+    {
+        fbm.addItem(juce::String(32 << i), true, proc.globalParams.fxBlock->getUserValueInt() == i,
+                    [this, i] { proc.globalParams.fxBlock->setUserValue(static_cast<float>(i)); });
+    }
+    m.addSubMenu("FX Block Size (Modulated)", fbm);
+
+    m.addItem("Multi-core Rendering", true, proc.globalParams.multicore->getUserValueBool(), [this] {
+        proc.globalParams.multicore->setUserValue(proc.globalParams.multicore->getUserValueBool() ? 0.0f : 1.0f);
+    });
+
     auto setSize = [this](const float scale) {
         if (auto p = findParentComponentOfClass<gin::ScaledPluginEditor>())
             p->setScale(scale);